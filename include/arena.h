@@ -0,0 +1,183 @@
+#pragma once
+
+// Fixed arenas for long-lived buffers, and a heap fragmentation watch.
+//
+// Each firmware plans its buffers at startup: it sums what it needs per
+// placement (ARENA_SIZE), takes one block per arena from the heap, and
+// carves everything out of it with arenaAlloc. Nothing is allocated or
+// freed in steady state; teardown frees whole arenas.
+//
+//   Arena psram;
+//   arenaInit(&psram, "motion", ARENA_SIZE(MotionGrid) + ..., ARENA_PSRAM);
+//   grid = (MotionGrid*)arenaAlloc(&psram, sizeof(MotionGrid));
+//   arenaReport();   // every registered arena: used / size / placement
+//
+// Placement: ARENA_INTERNAL_DMA for anything the SD or WiFi driver DMAs
+// from (write buffers), ARENA_PSRAM for large tables and rings touched by
+// the CPU only, ARENA_INTERNAL as their fallback on boards without PSRAM.
+//
+// heapWatchBegin() snapshots free / largest-free-block per heap once setup
+// is done; heapWatchTick() logs them every HEAP_WATCH_MS to Serial and
+// HEAP_WATCH_FILE as CSV, and warns when the largest free block shrinks -
+// a 24h run should show flat lines.
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "FS.h"
+#include "SD_MMC.h"
+#include "esp_heap_caps.h"
+
+#define ARENA_MAX 8
+#define ARENA_ALIGN 8
+#define ARENA_SIZE(x) (((x) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_INTERNAL_DMA (MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA)
+#define ARENA_INTERNAL MALLOC_CAP_INTERNAL
+#define ARENA_PSRAM MALLOC_CAP_SPIRAM
+
+#define HEAP_WATCH_MS 600000             // 10 min
+#define HEAP_WATCH_FILE "/heap.csv"
+#define HEAP_WATCH_SHRINK_PCT 10         // Warn when the largest block loses this much
+
+struct Arena {
+    const char* name;
+    uint8_t* base;
+    size_t size;
+    size_t used;
+    uint32_t caps;
+    uint16_t allocs;
+    uint16_t failed;
+};
+
+struct ArenaRegistry {
+    Arena* arenas[ARENA_MAX];
+    uint8_t count;
+};
+
+inline ArenaRegistry& arenaRegistry() {
+    static ArenaRegistry r = { {}, 0 };
+    return r;
+}
+
+static inline bool arenaInit(Arena* a, const char* name, size_t size, uint32_t caps) {
+    a->name = name;
+    a->size = ARENA_SIZE(size);
+    a->used = 0;
+    a->caps = caps;
+    a->allocs = 0;
+    a->failed = 0;
+    a->base = (uint8_t*)heap_caps_malloc(a->size, caps);
+    if (!a->base) {
+        Serial.printf("[ARENA] %s: %u bytes %s FAILED (largest free %u)\n", name, a->size,
+                      caps & MALLOC_CAP_SPIRAM ? "PSRAM" : "internal",
+                      heap_caps_get_largest_free_block(caps));
+        a->size = 0;
+        return false;
+    }
+    memset(a->base, 0, a->size);
+
+    ArenaRegistry& r = arenaRegistry();
+    bool listed = false;
+    for (uint8_t i = 0; i < r.count; i++) listed |= r.arenas[i] == a;
+    if (!listed && r.count < ARENA_MAX) r.arenas[r.count++] = a;
+    return true;
+}
+
+// Bump allocation, 8-byte aligned. Returns nullptr (and counts it) when full.
+static inline void* arenaAlloc(Arena* a, size_t size) {
+    size = ARENA_SIZE(size);
+    if (!a->base || a->used + size > a->size) {
+        a->failed++;
+        return nullptr;
+    }
+    void* p = a->base + a->used;
+    a->used += size;
+    a->allocs++;
+    return p;
+}
+
+// Returns the block to the heap (module teardown only)
+static inline void arenaFree(Arena* a) {
+    heap_caps_free(a->base);
+    a->base = nullptr;
+    a->size = 0;
+    a->used = 0;
+    a->allocs = 0;
+
+    ArenaRegistry& r = arenaRegistry();
+    for (uint8_t i = 0; i < r.count; i++) {
+        if (r.arenas[i] != a) continue;
+        r.arenas[i] = r.arenas[--r.count];
+        break;
+    }
+}
+
+static inline void arenaReport() {
+    ArenaRegistry& r = arenaRegistry();
+    size_t internal = 0, psram = 0;
+    for (uint8_t i = 0; i < r.count; i++) {
+        const Arena* a = r.arenas[i];
+        bool inPsram = a->caps & MALLOC_CAP_SPIRAM;
+        (inPsram ? psram : internal) += a->size;
+        Serial.printf("[ARENA] %-12s %-8s %7u / %7u bytes (%u%%) | %u allocs%s\n", a->name,
+                      inPsram ? "PSRAM" : "internal", a->used, a->size,
+                      a->size ? (unsigned)(a->used * 100 / a->size) : 0, a->allocs,
+                      a->failed ? " | OVERFLOW" : "");
+    }
+    Serial.printf("[ARENA] Total: %u internal, %u PSRAM | Heap free: %u internal, %u PSRAM\n",
+                  internal, psram, heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                  heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
+
+struct HeapSnapshot {
+    size_t internalFree;
+    size_t internalLargest;
+    size_t psramFree;
+    size_t psramLargest;
+};
+
+static inline HeapSnapshot heapSnapshot() {
+    HeapSnapshot s;
+    s.internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    s.internalLargest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    s.psramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    s.psramLargest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+    return s;
+}
+
+inline HeapSnapshot& heapBaseline() {
+    static HeapSnapshot s = {};
+    return s;
+}
+
+static inline void heapWatchBegin() {
+    heapBaseline() = heapSnapshot();
+    File f = SD_MMC.open(HEAP_WATCH_FILE, FILE_APPEND);
+    if (!f) return;
+    if (f.size() == 0) {
+        f.println("uptime_s,internal_free,internal_largest,internal_min,psram_free,psram_largest");
+    }
+    f.close();
+}
+
+static inline void heapWatchTick(uint32_t now) {
+    static uint32_t last = 0;
+    if (now - last < HEAP_WATCH_MS) return;
+    last = now;
+
+    HeapSnapshot s = heapSnapshot();
+    const HeapSnapshot& b = heapBaseline();
+    size_t minFree = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    bool shrunk = s.internalLargest * 100 < b.internalLargest * (100 - HEAP_WATCH_SHRINK_PCT) ||
+                  s.psramLargest * 100 < b.psramLargest * (100 - HEAP_WATCH_SHRINK_PCT);
+
+    Serial.printf("[HEAP] Internal: %u free, %u largest (boot %u) | PSRAM: %u free, %u largest (boot %u)%s\n",
+                  s.internalFree, s.internalLargest, b.internalLargest,
+                  s.psramFree, s.psramLargest, b.psramLargest,
+                  shrunk ? " | WARN fragmenting" : "");
+
+    File f = SD_MMC.open(HEAP_WATCH_FILE, FILE_APPEND);
+    if (!f) return;
+    f.printf("%lu,%u,%u,%u,%u,%u\n", now / 1000, s.internalFree, s.internalLargest, minFree,
+             s.psramFree, s.psramLargest);
+    f.close();
+}
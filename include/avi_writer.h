@@ -0,0 +1,219 @@
+#pragma once
+
+// Streaming MJPEG AVI writer.
+//
+// The header is written with placeholder sizes on open, frames are appended
+// as '00dc' chunks through a caller-supplied write buffer, and on close the
+// idx1 index is appended and the header rewritten in place with the final
+// counts. The index lives inside the writer, so nothing is allocated.
+//
+// F is any file type with write(const uint8_t*, size_t), seek(uint32_t) and
+// flush() - Arduino File on the device, a small stdio wrapper on the host.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef AVI_MAX_FRAMES
+#define AVI_MAX_FRAMES 1024
+#endif
+
+#define AVI_HEADER_SIZE 224
+#define AVI_MOVI_OFFSET 220      // 'movi' fourcc - idx1 offsets are relative to it
+#define AVI_IDX1_KEYFRAME 0x10
+#define AVI_AVIF_HASINDEX 0x10
+
+struct AviIndexEntry {
+    uint32_t offset;  // From the 'movi' fourcc
+    uint32_t size;
+};
+
+template <typename F>
+struct AviWriter {
+    F* file;
+    uint8_t* buf;
+    size_t bufSize;
+    size_t bufPos;
+    uint32_t moviBytes;     // Bytes after the 'movi' fourcc
+    uint32_t frames;
+    uint32_t maxFrame;
+    uint16_t width;
+    uint16_t height;
+    uint32_t firstMs;
+    uint32_t lastMs;
+    bool ok;
+    AviIndexEntry index[AVI_MAX_FRAMES];
+};
+
+static inline void aviPut32(uint8_t* p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static inline void aviPut16(uint8_t* p, uint16_t v) {
+    p[0] = v; p[1] = v >> 8;
+}
+
+static inline void aviPutTag(uint8_t* p, const char* tag) {
+    memcpy(p, tag, 4);
+}
+
+template <typename F>
+void aviBuildHeader(const AviWriter<F>* w, uint8_t* h) {
+    uint32_t usPerFrame = 100000;  // 10 fps until we know better
+    if (w->frames > 1 && w->lastMs > w->firstMs) {
+        usPerFrame = (uint64_t)(w->lastMs - w->firstMs) * 1000 / (w->frames - 1);
+        if (usPerFrame == 0) usPerFrame = 1;
+    }
+    uint32_t riffSize = AVI_HEADER_SIZE - 8 + w->moviBytes + 8 + w->frames * 16;
+
+    memset(h, 0, AVI_HEADER_SIZE);
+    aviPutTag(h + 0, "RIFF");
+    aviPut32(h + 4, riffSize);
+    aviPutTag(h + 8, "AVI ");
+
+    aviPutTag(h + 12, "LIST");
+    aviPut32(h + 16, 192);
+    aviPutTag(h + 20, "hdrl");
+
+    aviPutTag(h + 24, "avih");
+    aviPut32(h + 28, 56);
+    aviPut32(h + 32, usPerFrame);
+    aviPut32(h + 36, (uint64_t)w->maxFrame * 1000000 / usPerFrame);
+    aviPut32(h + 44, AVI_AVIF_HASINDEX);
+    aviPut32(h + 48, w->frames);
+    aviPut32(h + 56, 1);               // Streams
+    aviPut32(h + 60, w->maxFrame);
+    aviPut32(h + 64, w->width);
+    aviPut32(h + 68, w->height);
+
+    aviPutTag(h + 88, "LIST");
+    aviPut32(h + 92, 116);
+    aviPutTag(h + 96, "strl");
+
+    aviPutTag(h + 100, "strh");
+    aviPut32(h + 104, 56);
+    aviPutTag(h + 108, "vids");
+    aviPutTag(h + 112, "MJPG");
+    aviPut32(h + 128, usPerFrame);     // dwScale / dwRate = seconds per frame
+    aviPut32(h + 132, 1000000);
+    aviPut32(h + 140, w->frames);      // dwLength
+    aviPut32(h + 144, w->maxFrame);
+    aviPut32(h + 148, 0xFFFFFFFF);     // dwQuality: default
+    aviPut16(h + 160, w->width);       // rcFrame right/bottom
+    aviPut16(h + 162, w->height);
+
+    aviPutTag(h + 164, "strf");
+    aviPut32(h + 168, 40);
+    aviPut32(h + 172, 40);             // BITMAPINFOHEADER.biSize
+    aviPut32(h + 176, w->width);
+    aviPut32(h + 180, w->height);
+    aviPut16(h + 184, 1);
+    aviPut16(h + 186, 24);
+    aviPutTag(h + 188, "MJPG");
+    aviPut32(h + 192, (uint32_t)w->width * w->height * 3);
+
+    aviPutTag(h + 212, "LIST");
+    aviPut32(h + 216, 4 + w->moviBytes);
+    aviPutTag(h + 220, "movi");
+}
+
+template <typename F>
+bool aviFlush(AviWriter<F>* w) {
+    if (w->bufPos == 0) return w->ok;
+    if (w->file->write(w->buf, w->bufPos) != w->bufPos) w->ok = false;
+    w->bufPos = 0;
+    return w->ok;
+}
+
+// Small pieces go through the buffer; pieces bigger than the buffer are
+// written straight through after flushing what is queued.
+template <typename F>
+bool aviWrite(AviWriter<F>* w, const uint8_t* data, size_t len) {
+    if (w->bufPos + len > w->bufSize) {
+        if (!aviFlush(w)) return false;
+        if (len >= w->bufSize) {
+            if (w->file->write(data, len) != len) w->ok = false;
+            return w->ok;
+        }
+    }
+    memcpy(w->buf + w->bufPos, data, len);
+    w->bufPos += len;
+    return true;
+}
+
+template <typename F>
+bool aviOpen(AviWriter<F>* w, F* file, uint8_t* buf, size_t bufSize,
+             uint16_t width, uint16_t height) {
+    w->file = file;
+    w->buf = buf;
+    w->bufSize = bufSize;
+    w->bufPos = 0;
+    w->moviBytes = 0;
+    w->frames = 0;
+    w->maxFrame = 0;
+    w->width = width;
+    w->height = height;
+    w->firstMs = 0;
+    w->lastMs = 0;
+    w->ok = true;
+
+    uint8_t header[AVI_HEADER_SIZE];
+    aviBuildHeader(w, header);
+    return aviWrite(w, header, sizeof(header));
+}
+
+static inline bool aviFull(uint32_t frames) {
+    return frames >= AVI_MAX_FRAMES;
+}
+
+template <typename F>
+bool aviAddFrame(AviWriter<F>* w, const uint8_t* jpeg, size_t len, uint32_t ms) {
+    if (!w->ok || aviFull(w->frames)) return false;
+
+    uint8_t chunk[8];
+    aviPutTag(chunk, "00dc");
+    aviPut32(chunk + 4, len);
+
+    w->index[w->frames].offset = 4 + w->moviBytes;
+    w->index[w->frames].size = len;
+
+    aviWrite(w, chunk, sizeof(chunk));
+    aviWrite(w, jpeg, len);
+    if (len & 1) {
+        uint8_t pad = 0;
+        aviWrite(w, &pad, 1);
+    }
+    if (!w->ok) return false;
+
+    if (w->frames == 0) w->firstMs = ms;
+    w->lastMs = ms;
+    w->moviBytes += 8 + len + (len & 1);
+    if (len > w->maxFrame) w->maxFrame = len;
+    w->frames++;
+    return true;
+}
+
+// Appends idx1 and patches the header in place. Leaves the file open.
+template <typename F>
+bool aviClose(AviWriter<F>* w) {
+    uint8_t entry[16];
+    aviPutTag(entry, "idx1");
+    aviPut32(entry + 4, w->frames * 16);
+    aviWrite(w, entry, 8);
+
+    for (uint32_t i = 0; i < w->frames; i++) {
+        aviPutTag(entry, "00dc");
+        aviPut32(entry + 4, AVI_IDX1_KEYFRAME);
+        aviPut32(entry + 8, w->index[i].offset);
+        aviPut32(entry + 12, w->index[i].size);
+        aviWrite(w, entry, 16);
+    }
+    if (!aviFlush(w)) return false;
+
+    uint8_t header[AVI_HEADER_SIZE];
+    aviBuildHeader(w, header);
+    w->file->seek(0);
+    if (w->file->write(header, sizeof(header)) != sizeof(header)) w->ok = false;
+    w->file->flush();
+    return w->ok;
+}
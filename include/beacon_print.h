@@ -0,0 +1,127 @@
+#pragma once
+
+// Beacon fingerprints: FNV-1a hashes over the IEs of a beacon that only
+// change when the AP is reconfigured, split by what they cover, plus the
+// DS channel. The sniffer keeps one per BSSID; an unchanged beacon costs
+// one IE walk and a compare, and only a mismatch is decoded and reported.
+//
+//   ssid      SSID IE
+//   security  RSN IE, WPA vendor IE, capability privacy bit
+//   other     remaining IEs, minus the ones that change on their own
+//             (beaconPrintSkipped: TIM, BSS load, ERP / HT protection,
+//             quiet, channel switch) and vendor IEs, which often carry
+//             counters
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "dot11.h"
+
+#define BEACON_SEC_PRIVACY 0x01
+#define BEACON_SEC_WPA 0x02
+#define BEACON_SEC_RSN 0x04
+#define BEACON_SEC_PSK 0x08
+#define BEACON_SEC_SAE 0x10
+#define BEACON_SEC_8021X 0x20
+
+static const uint8_t BEACON_WPA_OUI[4] = { 0x00, 0x50, 0xf2, 0x01 };
+
+struct BeaconPrint {
+    uint32_t ssid;
+    uint32_t security;
+    uint32_t other;
+    uint8_t channel;  // 0 if the beacon has no DS parameter set
+};
+
+static inline bool beaconPrintEqual(const BeaconPrint& a, const BeaconPrint& b) {
+    return a.ssid == b.ssid && a.security == b.security && a.other == b.other && a.channel == b.channel;
+}
+
+static inline uint32_t beaconHash(uint32_t h, const uint8_t* p, size_t len) {
+    for (size_t i = 0; i < len; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+static inline bool beaconPrintSkipped(uint8_t tag) {
+    switch (tag) {
+        case 5:    // TIM
+        case 11:   // BSS load
+        case 37:   // Channel switch announcement
+        case 40:   // Quiet
+        case 42:   // ERP (protection bits)
+        case 60:   // Extended channel switch
+        case 61:   // HT operation (protection bits)
+        case 221:  // Vendor
+            return true;
+    }
+    return false;
+}
+
+static inline bool beaconIsWpa(uint8_t tag, const uint8_t* d, uint8_t len) {
+    return tag == 221 && len >= 4 && memcmp(d, BEACON_WPA_OUI, 4) == 0;
+}
+
+static inline BeaconPrint beaconPrint(const uint8_t* f, size_t len) {
+    const uint32_t basis = 2166136261u;
+    BeaconPrint p = { basis, basis, basis, 0 };
+    if (len < DOT11_HEADER_SIZE + DOT11_BEACON_FIXED) return p;
+    uint8_t privacy = f[DOT11_HEADER_SIZE + 10] & 0x10;
+    p.security = beaconHash(p.security, &privacy, 1);
+    dot11ForEachIe(f, len, [&](uint8_t tag, const uint8_t* d, uint8_t ieLen) {
+        uint8_t tl[2] = { tag, ieLen };
+        if (tag == DOT11_IE_SSID) {
+            p.ssid = beaconHash(p.ssid, d, ieLen);
+        } else if (tag == DOT11_IE_DS_PARAMS) {
+            if (ieLen == 1) p.channel = d[0];
+        } else if (tag == 48 || beaconIsWpa(tag, d, ieLen)) {
+            p.security = beaconHash(beaconHash(p.security, tl, 2), d, ieLen);
+        } else if (!beaconPrintSkipped(tag)) {
+            p.other = beaconHash(beaconHash(p.other, tl, 2), d, ieLen);
+        }
+        return true;
+    });
+    return p;
+}
+
+// AKM suite types (00-0F-AC:n in RSN, 00-50-F2:n in WPA)
+static inline uint8_t beaconAkms(const uint8_t* d, uint8_t len, uint8_t at) {
+    // at: offset of the pairwise count (after version and group cipher)
+    uint8_t flags = 0;
+    if (at + 2 > len) return 0;
+    uint16_t pairwise = d[at] | d[at + 1] << 8;
+    size_t pos = at + 2 + 4 * pairwise;
+    if (pos + 2 > len) return 0;
+    uint16_t akms = d[pos] | d[pos + 1] << 8;
+    pos += 2;
+    for (uint16_t i = 0; i < akms && pos + 4 <= len; i++, pos += 4) {
+        switch (d[pos + 3]) {
+            case 1: case 3: case 5: flags |= BEACON_SEC_8021X; break;
+            case 2: case 4: case 6: flags |= BEACON_SEC_PSK; break;
+            case 8: case 9: flags |= BEACON_SEC_SAE; break;
+        }
+    }
+    return flags;
+}
+
+// BEACON_SEC_* of a beacon - the slow path, for reporting a change
+static inline uint8_t beaconSecurity(const uint8_t* f, size_t len) {
+    if (len < DOT11_HEADER_SIZE + DOT11_BEACON_FIXED) return 0;
+    uint8_t sec = f[DOT11_HEADER_SIZE + 10] & 0x10 ? BEACON_SEC_PRIVACY : 0;
+    dot11ForEachIe(f, len, [&](uint8_t tag, const uint8_t* d, uint8_t ieLen) {
+        if (tag == 48) sec |= BEACON_SEC_RSN | beaconAkms(d, ieLen, 6);
+        else if (beaconIsWpa(tag, d, ieLen)) sec |= BEACON_SEC_WPA | beaconAkms(d, ieLen, 10);
+        return true;
+    });
+    return sec;
+}
+
+// "open", "WEP", "WPA2-PSK", "WPA2/WPA3-SAE", "WPA/WPA2-802.1X", ...
+static inline const char* beaconSecurityName(uint8_t sec, char* buf, size_t size) {
+    if (!(sec & (BEACON_SEC_WPA | BEACON_SEC_RSN))) return sec & BEACON_SEC_PRIVACY ? "WEP" : "open";
+    const char* wpa = sec & BEACON_SEC_WPA ? (sec & BEACON_SEC_RSN ? "WPA/WPA2" : "WPA")
+                      : sec & BEACON_SEC_SAE ? (sec & BEACON_SEC_PSK ? "WPA2/WPA3" : "WPA3") : "WPA2";
+    snprintf(buf, size, "%s%s%s%s", wpa, sec & BEACON_SEC_PSK ? "-PSK" : "",
+             sec & BEACON_SEC_SAE ? "-SAE" : "", sec & BEACON_SEC_8021X ? "-802.1X" : "");
+    return buf;
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+// Deferred-format logging for hot paths (promiscuous callbacks, per-frame code).
+//
+//   LOGI("[NEW] %s | CH: %d\n", logText(ssid), ch);
+//
+// A call copies the format string pointer, a millis() stamp and up to
+// BINLOG_MAX_ARGS raw 32-bit arguments into a RAM ring - no formatting, no
+// UART. A low-priority task (binlogBegin) formats and prints them later, so
+// the caller never waits on the 115200 baud FIFO. When the ring is full the
+// new entry is dropped and counted; the task reports drops as they happen.
+//
+// Arguments must be 32-bit integers or pointers (no float/double/64-bit).
+// %s pointers are printed later, so they must outlive the call: use string
+// literals, or wrap one stack buffer per call in logText() to copy it.
+//
+// Levels below LOG_LEVEL (set with -DLOG_LEVEL=...) compile to nothing.
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define BINLOG_ENTRIES 128  // x 80 bytes internal RAM
+#define BINLOG_MAX_ARGS 8
+#define BINLOG_TEXT 36      // logText() copy, fits an SSID
+#define BINLOG_POLL_MS 20
+#define BINLOG_LINE 192
+
+#define LOG_AT(level, fmt, ...) \
+    do { if ((level) >= LOG_LEVEL) binlogWrite((level), fmt, ##__VA_ARGS__); } while (0)
+#define LOGD(fmt, ...) LOG_AT(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#define LOGI(fmt, ...) LOG_AT(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#define LOGW(fmt, ...) LOG_AT(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#define LOGE(fmt, ...) LOG_AT(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+
+struct BinlogEntry {
+    const char* fmt;
+    uint32_t ms;
+    uint8_t level;
+    uint8_t nargs;
+    int8_t textArg;  // Argument slot printed from text, -1 if none
+    uint8_t reserved;
+    uintptr_t args[BINLOG_MAX_ARGS];  // 32-bit on the ESP32
+    char text[BINLOG_TEXT];
+};
+
+struct BinlogText {
+    const char* s;
+};
+
+static inline BinlogText logText(const char* s) {
+    return { s };
+}
+
+struct Binlog {
+    BinlogEntry ring[BINLOG_ENTRIES];
+    uint16_t head;  // Next slot to write
+    uint16_t count;
+    volatile uint32_t written;
+    volatile uint32_t dropped;
+    portMUX_TYPE lock;
+    TaskHandle_t task;
+};
+
+// One ring per image, shared by every translation unit (function-local
+// static in an inline function), so multi.cpp modules share it too.
+inline Binlog& binlog() {
+    static Binlog log = { {}, 0, 0, 0, 0, portMUX_INITIALIZER_UNLOCKED, nullptr };
+    return log;
+}
+
+template<class T>
+static inline uintptr_t binlogWord(T* v) {
+    return (uintptr_t)v;
+}
+
+template<class T>
+static inline uintptr_t binlogWord(T v) {
+    static_assert(sizeof(T) <= 4 && !std::is_floating_point<T>::value,
+                  "binlog arguments must be 32-bit integers or pointers");
+    return (uintptr_t)v;
+}
+
+static inline void binlogPack(BinlogEntry&) {}
+
+template<class... Rest>
+static inline void binlogPack(BinlogEntry& e, BinlogText t, Rest... rest);
+
+template<class T, class... Rest>
+static inline void binlogPack(BinlogEntry& e, T v, Rest... rest) {
+    e.args[e.nargs++] = binlogWord(v);
+    binlogPack(e, rest...);
+}
+
+template<class... Rest>
+static inline void binlogPack(BinlogEntry& e, BinlogText t, Rest... rest) {
+    strncpy(e.text, t.s, BINLOG_TEXT - 1);
+    e.text[BINLOG_TEXT - 1] = 0;
+    e.textArg = e.nargs;
+    e.args[e.nargs++] = 0;
+    binlogPack(e, rest...);
+}
+
+template<class... Args>
+static inline void binlogWrite(uint8_t level, const char* fmt, Args... args) {
+    static_assert(sizeof...(Args) <= BINLOG_MAX_ARGS, "too many binlog arguments");
+    BinlogEntry e;
+    e.fmt = fmt;
+    e.ms = millis();
+    e.level = level;
+    e.nargs = 0;
+    e.textArg = -1;
+    binlogPack(e, args...);
+
+    Binlog& log = binlog();
+    size_t size = offsetof(BinlogEntry, text) + (e.textArg >= 0 ? BINLOG_TEXT : 0);
+    portENTER_CRITICAL_SAFE(&log.lock);
+    if (log.count < BINLOG_ENTRIES) {
+        memcpy(&log.ring[log.head], &e, size);
+        log.head = (log.head + 1) % BINLOG_ENTRIES;
+        log.count++;
+        log.written++;
+    } else {
+        log.dropped++;
+    }
+    portEXIT_CRITICAL_SAFE(&log.lock);
+}
+
+static inline bool binlogPop(BinlogEntry* out) {
+    Binlog& log = binlog();
+    bool got = false;
+    portENTER_CRITICAL(&log.lock);
+    if (log.count) {
+        uint16_t tail = (log.head + BINLOG_ENTRIES - log.count) % BINLOG_ENTRIES;
+        memcpy(out, &log.ring[tail], sizeof(*out));
+        log.count--;
+        got = true;
+    }
+    portEXIT_CRITICAL(&log.lock);
+    return got;
+}
+
+static inline void binlogPrint(const BinlogEntry& e) {
+    static const char LEVELS[] = "DIWE";
+    uintptr_t a[BINLOG_MAX_ARGS] = {};
+    memcpy(a, e.args, e.nargs * sizeof(a[0]));
+    if (e.textArg >= 0) a[e.textArg] = (uintptr_t)e.text;
+
+    char line[BINLOG_LINE];
+    snprintf(line, sizeof(line), e.fmt, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+    if (e.level >= LOG_LEVEL_WARN) Serial.printf("%c %lu ", LEVELS[e.level], e.ms);
+    Serial.print(line);
+}
+
+// Drains the ring. Call directly to flush, e.g. before a reboot.
+static inline void binlogDrain() {
+    static uint32_t reportedDrops = 0;
+    BinlogEntry e;
+    while (binlogPop(&e)) binlogPrint(e);
+
+    uint32_t dropped = binlog().dropped;
+    if (dropped != reportedDrops) {
+        Serial.printf("[LOG] %lu entries dropped (ring full)\n", dropped - reportedDrops);
+        reportedDrops = dropped;
+    }
+}
+
+static inline void binlogTask(void*) {
+    while (true) {
+        binlogDrain();
+        vTaskDelay(pdMS_TO_TICKS(BINLOG_POLL_MS));
+    }
+}
+
+// Starts the printing task once per image; entries logged earlier wait in the ring
+static inline void binlogBegin() {
+    Binlog& log = binlog();
+    if (log.task) return;
+    xTaskCreate(binlogTask, "binlog", 3072, nullptr, 1, &log.task);
+}
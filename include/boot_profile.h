@@ -0,0 +1,99 @@
+#pragma once
+
+// Boot phase timing and parallel init.
+//
+//   int p = bootPhaseBegin("camera"); initCamera(); bootPhaseEnd(p);
+//
+//   BootTask sd;
+//   bootStart(&sd, "sd", initStorage, 0);  // runs on core 0 as its own phase
+//   ...                                    // other init meanwhile
+//   bootWait(&sd);
+//
+//   bootProfilePrint();                    // one line per phase, then resets
+//
+// Times are from app start (esp_timer); the ROM and 2nd stage bootloader
+// before that are not included.
+
+#include <stdint.h>
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define BOOT_MAX_PHASES 16
+#define BOOT_TASK_STACK 6144
+
+struct BootPhase {
+    const char* name;
+    int64_t startUs;
+    int64_t endUs;
+    uint8_t core;
+};
+
+struct BootTask {
+    const char* name;
+    void (*fn)();
+    SemaphoreHandle_t done;
+};
+
+static BootPhase bootPhases[BOOT_MAX_PHASES];
+static int bootPhaseCount = 0;
+static portMUX_TYPE bootPhaseLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Returns the phase slot, or -1 once the table is full
+static inline int bootPhaseBegin(const char* name) {
+    int i = -1;
+    portENTER_CRITICAL(&bootPhaseLock);
+    if (bootPhaseCount < BOOT_MAX_PHASES) i = bootPhaseCount++;
+    portEXIT_CRITICAL(&bootPhaseLock);
+    if (i < 0) return -1;
+
+    bootPhases[i].name = name;
+    bootPhases[i].startUs = esp_timer_get_time();
+    bootPhases[i].endUs = 0;
+    bootPhases[i].core = xPortGetCoreID();
+    return i;
+}
+
+static inline void bootPhaseEnd(int i) {
+    if (i >= 0) bootPhases[i].endUs = esp_timer_get_time();
+}
+
+static inline void bootTaskEntry(void* arg) {
+    BootTask* t = (BootTask*)arg;
+    int p = bootPhaseBegin(t->name);
+    t->fn();
+    bootPhaseEnd(p);
+    xSemaphoreGive(t->done);
+    vTaskDelete(nullptr);
+}
+
+static inline void bootStart(BootTask* t, const char* name, void (*fn)(), int core) {
+    t->name = name;
+    t->fn = fn;
+    t->done = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(bootTaskEntry, name, BOOT_TASK_STACK, t, 1, nullptr, core);
+}
+
+static inline void bootWait(BootTask* t) {
+    xSemaphoreTake(t->done, portMAX_DELAY);
+    vSemaphoreDelete(t->done);
+    t->done = nullptr;
+}
+
+static inline void bootProfilePrint() {
+    int64_t first = bootPhaseCount ? bootPhases[0].startUs : 0;
+    for (int i = 0; i < bootPhaseCount; i++) {
+        const BootPhase& p = bootPhases[i];
+        if (p.startUs < first) first = p.startUs;
+    }
+    for (int i = 0; i < bootPhaseCount; i++) {
+        const BootPhase& p = bootPhases[i];
+        int64_t end = p.endUs ? p.endUs : esp_timer_get_time();
+        Serial.printf("[BOOT] %-10s core %u | at %5lu ms | %5lu ms%s\n", p.name, p.core,
+                      (uint32_t)((p.startUs - first) / 1000), (uint32_t)((end - p.startUs) / 1000),
+                      p.endUs ? "" : " (running)");
+    }
+    Serial.printf("[BOOT] Ready %lu ms after app start\n", (uint32_t)(esp_timer_get_time() / 1000));
+    bootPhaseCount = 0;
+}
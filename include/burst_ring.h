@@ -0,0 +1,158 @@
+#pragma once
+
+// Burst ring: a large byte ring (PSRAM) between the promiscuous callback and
+// the SD writer, so a traffic spike is absorbed at radio rate and written out
+// at SD rate afterwards.
+//
+// Entries are finished pcap records - the 16-byte record header, then the
+// frame, padded to 4 bytes - so draining is a copy into the SD write buffer.
+// Entries never straddle the end of the ring: a writer that reaches the end
+// leaves a wrap marker (or a gap shorter than a header, which readers skip)
+// and continues at 0.
+//
+// When an entry doesn't fit, the policy decides:
+//   BURST_DROP_NEWEST  the new frame is dropped
+//   BURST_DROP_OLDEST  the oldest entries are dropped to make room
+//   BURST_HEADERS      past 3/4 full, frames are stored cut to BURST_SNAP
+//                      bytes (incl_len < orig_len, as a snaplen would),
+//                      dropped only when even that doesn't fit
+//
+// No locking here: the sniffer serializes every call on one spinlock, and
+// the drain copies an entry out before dropping it, so nothing outside the
+// lock points into the ring.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BURST_RECORD_HEADER 16
+#define BURST_SNAP 64              // 802.11 + QoS + LLC/SNAP + start of IP
+#define BURST_WRAP 0xffffffff      // incl_len of a wrap marker
+#define BURST_ENTRY(len) ((BURST_RECORD_HEADER + (len) + 3) & ~(uint32_t)3)
+
+enum BurstPolicy : uint8_t {
+    BURST_DROP_NEWEST,
+    BURST_DROP_OLDEST,
+    BURST_HEADERS,
+};
+
+static const char* const BURST_POLICY_NAMES[] = { "newest", "oldest", "headers" };
+
+enum BurstResult : uint8_t {
+    BURST_STORED,
+    BURST_TRUNCATED,
+    BURST_DROPPED,
+};
+
+struct BurstStats {
+    uint32_t frames;     // Stored, truncated included
+    uint32_t truncated;
+    uint32_t dropped;
+    uint32_t evicted;    // Stored, then dropped for newer frames
+    uint32_t peakUsed;   // Bytes, since burstInit
+};
+
+struct BurstRing {
+    uint8_t* buf;
+    uint32_t size;      // Multiple of 4
+    uint32_t head;      // Next write
+    uint32_t tail;      // Oldest entry
+    uint32_t used;      // Bytes between tail and head, skipped ends included
+    uint32_t entries;
+    uint8_t policy;
+    BurstStats stats;
+};
+
+static inline void burstInit(BurstRing* r, uint8_t* buf, uint32_t size, uint8_t policy) {
+    memset(r, 0, sizeof(*r));
+    r->buf = buf;
+    r->size = size & ~(uint32_t)3;
+    r->policy = policy;
+}
+
+// Bytes of one entry at tail, after skipping a wrap there
+static inline uint32_t burstSkipWrap(BurstRing* r) {
+    uint32_t rest = r->size - r->tail;
+    if (rest < BURST_RECORD_HEADER ||
+        *(const uint32_t*)(r->buf + r->tail + 8) == BURST_WRAP) {
+        r->used -= rest;
+        r->tail = 0;
+    }
+    return BURST_ENTRY(*(const uint32_t*)(r->buf + r->tail + 8));
+}
+
+static inline void burstDropTail(BurstRing* r) {
+    uint32_t entry = burstSkipWrap(r);
+    r->tail += entry;
+    if (r->tail == r->size) r->tail = 0;
+    r->used -= entry;
+    r->entries--;
+    if (!r->entries) r->head = r->tail = r->used = 0;
+}
+
+// Where an entry of need bytes would start, or -1 if it doesn't fit
+static inline int64_t burstSlot(const BurstRing* r, uint32_t need) {
+    if (!r->entries) return need <= r->size ? 0 : -1;
+    if (r->head > r->tail) {
+        if (need <= r->size - r->head) return r->head;
+        return need <= r->tail ? 0 : -1;
+    }
+    if (r->head < r->tail && need <= r->tail - r->head) return r->head;
+    return -1;
+}
+
+static inline BurstResult burstPush(BurstRing* r, const uint8_t* frame, uint32_t len, uint64_t us) {
+    uint32_t incl = len;
+    if (r->policy == BURST_HEADERS && len > BURST_SNAP &&
+        r->used + BURST_ENTRY(len) > r->size / 4 * 3) {
+        incl = BURST_SNAP;
+    }
+    uint32_t need = BURST_ENTRY(incl);
+    int64_t at = burstSlot(r, need);
+    if (at < 0 && r->policy == BURST_DROP_OLDEST) {
+        while (at < 0 && r->entries) {
+            burstDropTail(r);
+            r->stats.evicted++;
+            at = burstSlot(r, need);
+        }
+    }
+    if (at < 0) {
+        r->stats.dropped++;
+        return BURST_DROPPED;
+    }
+
+    if (at != r->head) {
+        // Wrapping: mark the end so readers skip it
+        uint32_t rest = r->size - r->head;
+        if (rest >= BURST_RECORD_HEADER) *(uint32_t*)(r->buf + r->head + 8) = BURST_WRAP;
+        r->used += rest;
+    }
+    uint32_t header[4] = { (uint32_t)(us / 1000000), (uint32_t)(us % 1000000), incl, len };
+    uint8_t* p = r->buf + at;
+    memcpy(p, header, BURST_RECORD_HEADER);
+    memcpy(p + BURST_RECORD_HEADER, frame, incl);
+    r->head = at + need;
+    if (r->head == r->size) r->head = 0;
+    r->used += need;
+    r->entries++;
+
+    r->stats.frames++;
+    if (r->used > r->stats.peakUsed) r->stats.peakUsed = r->used;
+    if (incl < len) {
+        r->stats.truncated++;
+        return BURST_TRUNCATED;
+    }
+    return BURST_STORED;
+}
+
+// Copies the oldest entry to dst as a pcap record (header + frame) and drops
+// it. Returns its length; 0 when empty or when it is longer than cap.
+static inline uint32_t burstTake(BurstRing* r, uint8_t* dst, uint32_t cap) {
+    if (!r->entries) return 0;
+    burstSkipWrap(r);
+    uint32_t len = BURST_RECORD_HEADER + *(const uint32_t*)(r->buf + r->tail + 8);
+    if (len > cap) return 0;
+    memcpy(dst, r->buf + r->tail, len);
+    burstDropTail(r);
+    return len;
+}
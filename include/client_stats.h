@@ -0,0 +1,274 @@
+#pragma once
+
+// Client activity: per-BSSID traffic and station counts accumulated on the
+// device from data and management frames, and written as fixed 48-byte
+// records every interval (/clients/<timestamp>.cli) - the load picture of a
+// site without keeping a single payload.
+//
+// Each interval writes one record per BSSID heard, then one site record:
+//   BSS   frames, data frames and bytes (all / uplink), data retries, mean
+//         RSSI, and the stations seen exchanging data with it. Null-data
+//         keepalives count, so idle associated stations show up too
+//   site  all frames, probe requests, distinct stations: associated,
+//         probing, and probing from a randomized (locally administered)
+//         address - one phone can show up as several of those
+//
+// The BSS and station tables are MacMaps (mac_map.h), and a MacSet of
+// (station, BSS) pairs counts each station once per BSS however often it
+// roams: per frame at most three inserts, nothing allocated. A full table
+// refuses new keys and flags every record of the interval. Byte counts
+// accumulate in 64 bits and saturate at 4 GB per interval in the record. Framing
+// is record_frame.h, as in survey.h: a 16-byte header, then records with a
+// Fletcher-16 check so a torn tail record is skipped by readers.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "dot11.h"
+#include "mac_map.h"
+#include "record_frame.h"
+
+#define CLIENT_MAGIC "CLNT"
+#define CLIENT_VERSION 1
+#define CLIENT_HEADER_SIZE RECORD_HEADER_SIZE
+#define CLIENT_RECORD_SIZE 48
+
+#define CLIENT_KIND_SITE 1
+#define CLIENT_KIND_BSS 2
+
+#define CLIENT_CLOCK_SET 0x01      // time is wall clock, not seconds since boot
+#define CLIENT_BSS_SATURATED 0x02  // More BSSIDs than the table holds
+#define CLIENT_STA_SATURATED 0x04  // More stations than the table holds
+
+#define CLIENT_STA_DATA 0x01       // Seen in a data frame with a BSSID
+#define CLIENT_STA_PROBED 0x02     // Sent a probe request
+
+struct ClientHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint8_t reserved[8];
+};
+
+struct ClientBssRecord {
+    uint32_t time;        // time() at the end of the interval
+    uint32_t uptimeS;
+    uint16_t intervalS;
+    uint8_t kind;         // CLIENT_KIND_BSS
+    uint8_t flags;
+    uint8_t bssid[6];
+    uint16_t stations;    // Distinct, exchanging data with this BSSID
+    uint32_t frames;      // Every frame carrying this BSSID, beacons included
+    uint32_t dataFrames;
+    uint32_t dataBytes;   // 802.11 length, FCS included; saturates
+    uint32_t upFrames;    // Data to the DS (station -> AP)
+    uint32_t upBytes;
+    uint32_t dataRetries;
+    uint8_t channel;      // Of the last frame
+    int8_t rssiMean;
+    uint16_t check;
+};
+
+struct ClientSiteRecord {
+    uint32_t time;
+    uint32_t uptimeS;
+    uint16_t intervalS;
+    uint8_t kind;         // CLIENT_KIND_SITE
+    uint8_t flags;
+    uint32_t frames;      // Every frame heard
+    uint32_t dataFrames;
+    uint32_t probeRequests;
+    uint16_t bssids;
+    uint16_t stations;    // Distinct, associated and probing together
+    uint16_t associated;
+    uint16_t probing;
+    uint16_t probingRandom;
+    uint8_t reserved[12];
+    uint16_t check;
+};
+
+// Both kinds share the first 12 bytes, so kind can be read from either
+union ClientRecord {
+    ClientBssRecord bss;
+    ClientSiteRecord site;
+};
+
+static_assert(sizeof(ClientHeader) == CLIENT_HEADER_SIZE, "client header layout");
+static_assert(sizeof(ClientBssRecord) == CLIENT_RECORD_SIZE, "client BSS record layout");
+static_assert(sizeof(ClientSiteRecord) == CLIENT_RECORD_SIZE, "client site record layout");
+
+// Accumulated between records
+struct ClientBss {
+    uint64_t dataBytes;
+    uint64_t upBytes;
+    uint32_t frames;
+    uint32_t dataFrames;
+    uint32_t upFrames;
+    uint32_t dataRetries;
+    int32_t rssiSum;
+    uint16_t stations;
+    uint8_t channel;
+};
+
+struct ClientSta {
+    uint8_t flags;   // CLIENT_STA_*
+};
+
+struct ClientBank {
+    MacMap<ClientBss> bss;
+    MacMap<ClientSta> stations;
+    MacSet pairs;    // Station MAC tagged with its BSS slot
+    uint32_t frames;
+    uint32_t dataFrames;
+    uint32_t probeRequests;
+    uint32_t associated;
+    uint32_t probing;
+    uint32_t probingRandom;
+};
+
+// maxBss is at most 0x8000, so a BSS slot fits a MacSet tag
+static inline size_t clientBankBytes(uint32_t maxBss, uint32_t maxStations) {
+    return macMapBytes<ClientBss>(maxBss) + macMapBytes<ClientSta>(maxStations) +
+           macSetBytes(maxStations);
+}
+
+static inline void clientInit(ClientBank* b, void* storage, uint32_t maxBss, uint32_t maxStations) {
+    memset(b, 0, sizeof(*b));
+    uint8_t* p = (uint8_t*)storage;
+    macMapInit(&b->bss, p, maxBss);
+    if (p) p += macMapBytes<ClientBss>(maxBss);
+    macMapInit(&b->stations, p, maxStations);
+    if (p) p += macMapBytes<ClientSta>(maxStations);
+    macSetInit(&b->pairs, p, maxStations);
+}
+
+static inline void clientClear(ClientBank* b) {
+    MacMap<ClientBss> bss = b->bss;
+    MacMap<ClientSta> stations = b->stations;
+    MacSet pairs = b->pairs;
+    memset(b, 0, sizeof(*b));
+    b->bss = bss;
+    b->stations = stations;
+    b->pairs = pairs;
+    macMapClear(&b->bss);
+    macMapClear(&b->stations);
+    macSetClear(&b->pairs);
+}
+
+// Marks mac as a station doing flag; with bss, also counts it for that BSS.
+// A station that roams within the interval counts once for each BSS.
+static inline void clientStation(ClientBank* b, const uint8_t* mac, uint8_t flag, ClientBss* bss) {
+    bool added;
+    ClientSta* s = macMapInsert(&b->stations, mac, &added);
+    if (!s) return;
+    if (!(s->flags & flag)) {
+        s->flags |= flag;
+        if (flag == CLIENT_STA_DATA) {
+            b->associated++;
+        } else {
+            b->probing++;
+            if (mac[0] & 0x02) b->probingRandom++;
+        }
+    }
+    if (bss && macSetInsert(&b->pairs, mac, (uint16_t)(bss - b->bss.values))) bss->stations++;
+}
+
+static inline void clientAdd(ClientBank* b, const uint8_t* f, uint32_t len, int rssi, uint8_t channel) {
+    b->frames++;
+    if (len < DOT11_HEADER_SIZE) return;
+    uint8_t type = dot11Type(f);
+    if (type == DOT11_TYPE_MGMT && dot11Subtype(f) == DOT11_SUBTYPE_PROBE_REQ) {
+        b->probeRequests++;
+        clientStation(b, f + 10, CLIENT_STA_PROBED, nullptr);
+        return;
+    }
+    if (type == DOT11_TYPE_DATA) b->dataFrames++;
+
+    const uint8_t* bssid = dot11Bssid(f, len);
+    if (!bssid) return;
+    bool added;
+    ClientBss* bss = macMapInsert(&b->bss, bssid, &added);
+    if (!bss) return;
+    bss->frames++;
+    bss->rssiSum += rssi;
+    bss->channel = channel;
+    if (type != DOT11_TYPE_DATA) return;
+
+    bss->dataFrames++;
+    bss->dataBytes += len;
+    if (dot11Retry(f)) bss->dataRetries++;
+    // To DS: the station sent it (addr2); from DS: it's for the station
+    // (addr1), unless that is a group address
+    const uint8_t* sta = nullptr;
+    switch (f[1] & 3) {
+        case 1:
+            bss->upFrames++;
+            bss->upBytes += len;
+            sta = f + 10;
+            break;
+        case 2:
+            sta = f + 4;
+            break;
+    }
+    if (sta && !(sta[0] & 1)) clientStation(b, sta, CLIENT_STA_DATA, bss);
+}
+
+static inline bool clientValid(const ClientRecord* r) {
+    return r->bss.check == recordCheck(r, CLIENT_RECORD_SIZE - 2) &&
+           (r->bss.kind == CLIENT_KIND_BSS || r->bss.kind == CLIENT_KIND_SITE);
+}
+
+static inline void clientHeader(ClientHeader* h) {
+    recordHeaderInit(h, CLIENT_MAGIC, CLIENT_VERSION, CLIENT_RECORD_SIZE);
+}
+
+static inline bool clientHeaderValid(const ClientHeader* h) {
+    return recordHeaderValid(h, CLIENT_MAGIC, CLIENT_VERSION, CLIENT_RECORD_SIZE);
+}
+
+static inline uint8_t clientFlags(const ClientBank* b, uint8_t flags) {
+    return flags | (b->bss.refused ? CLIENT_BSS_SATURATED : 0) |
+           (b->stations.refused || b->pairs.refused ? CLIENT_STA_SATURATED : 0);
+}
+
+static inline void clientBssRecord(ClientBssRecord* r, const ClientBank* b, const uint8_t* bssid,
+                                   const ClientBss* c, uint32_t time, uint32_t uptimeS,
+                                   uint16_t intervalS, uint8_t flags) {
+    memset(r, 0, sizeof(*r));
+    r->time = time;
+    r->uptimeS = uptimeS;
+    r->intervalS = intervalS;
+    r->kind = CLIENT_KIND_BSS;
+    r->flags = clientFlags(b, flags);
+    memcpy(r->bssid, bssid, 6);
+    r->stations = c->stations;
+    r->frames = c->frames;
+    r->dataFrames = c->dataFrames;
+    r->dataBytes = recordSat32(c->dataBytes);
+    r->upFrames = c->upFrames;
+    r->upBytes = recordSat32(c->upBytes);
+    r->dataRetries = c->dataRetries;
+    r->channel = c->channel;
+    r->rssiMean = c->frames ? c->rssiSum / (int32_t)c->frames : 0;
+    r->check = recordCheck(r, CLIENT_RECORD_SIZE - 2);
+}
+
+static inline void clientSiteRecord(ClientSiteRecord* r, const ClientBank* b, uint32_t time,
+                                    uint32_t uptimeS, uint16_t intervalS, uint8_t flags) {
+    memset(r, 0, sizeof(*r));
+    r->time = time;
+    r->uptimeS = uptimeS;
+    r->intervalS = intervalS;
+    r->kind = CLIENT_KIND_SITE;
+    r->flags = clientFlags(b, flags);
+    r->frames = b->frames;
+    r->dataFrames = b->dataFrames;
+    r->probeRequests = b->probeRequests;
+    r->bssids = recordSat16(b->bss.count);
+    r->stations = recordSat16(b->stations.count);
+    r->associated = recordSat16(b->associated);
+    r->probing = recordSat16(b->probing);
+    r->probingRandom = recordSat16(b->probingRandom);
+    r->check = recordCheck(r, CLIENT_RECORD_SIZE - 2);
+}
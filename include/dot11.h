@@ -0,0 +1,108 @@
+#pragma once
+
+// Minimal 802.11 frame accessors for captured frames (pcap linktype 105, as
+// the sniffer writes them: MAC header first, FCS last). Shared by firmware
+// and host tools, so plain C types only. Every accessor takes the captured
+// length and returns nullptr / false rather than read past it.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DOT11_TYPE_MGMT 0
+#define DOT11_TYPE_CTRL 1
+#define DOT11_TYPE_DATA 2
+
+#define DOT11_SUBTYPE_ASSOC_REQ 0
+#define DOT11_SUBTYPE_PROBE_REQ 4
+#define DOT11_SUBTYPE_PROBE_RESP 5
+#define DOT11_SUBTYPE_BEACON 8
+#define DOT11_SUBTYPE_DISASSOC 10
+#define DOT11_SUBTYPE_AUTH 11
+#define DOT11_SUBTYPE_DEAUTH 12
+
+#define DOT11_HEADER_SIZE 24
+#define DOT11_BEACON_FIXED 12  // Timestamp, interval, capabilities
+#define DOT11_FCS_SIZE 4
+
+#define DOT11_IE_SSID 0
+#define DOT11_IE_DS_PARAMS 3
+
+static inline uint8_t dot11Type(const uint8_t* f) {
+    return (f[0] >> 2) & 3;
+}
+
+static inline uint8_t dot11Subtype(const uint8_t* f) {
+    return f[0] >> 4;
+}
+
+static inline bool dot11Retry(const uint8_t* f) {
+    return f[1] & 0x08;
+}
+
+static inline bool dot11HasBeaconIes(const uint8_t* f) {
+    return dot11Type(f) == DOT11_TYPE_MGMT &&
+           (dot11Subtype(f) == DOT11_SUBTYPE_BEACON || dot11Subtype(f) == DOT11_SUBTYPE_PROBE_RESP);
+}
+
+// BSSID by frame type and DS bits; nullptr for control and WDS frames and
+// for the wildcard (broadcast) BSSID of probe requests
+static inline const uint8_t* dot11Bssid(const uint8_t* f, size_t len) {
+    if (len < DOT11_HEADER_SIZE) return nullptr;
+    const uint8_t* bssid = nullptr;
+    uint8_t type = dot11Type(f);
+    if (type == DOT11_TYPE_MGMT) {
+        bssid = f + 16;
+    } else if (type == DOT11_TYPE_DATA) {
+        switch (f[1] & 3) {
+            case 0: bssid = f + 16; break;  // IBSS / direct
+            case 1: bssid = f + 4; break;   // To DS: addr1
+            case 2: bssid = f + 10; break;  // From DS: addr2
+        }
+    }
+    return bssid && !(bssid[0] & 1) ? bssid : nullptr;
+}
+
+// Transmitter address (addr2); nullptr for CTS / ACK, which carry only addr1
+static inline const uint8_t* dot11Transmitter(const uint8_t* f, size_t len) {
+    if (len < 16) return nullptr;
+    if (dot11Type(f) == DOT11_TYPE_CTRL) {
+        uint8_t sub = dot11Subtype(f);
+        if (sub == 12 || sub == 13) return nullptr;
+    }
+    return f + 10;
+}
+
+// Calls fn(tag, data, len) for each IE of a beacon / probe response until
+// it returns false. The trailing FCS is excluded; a truncated IE ends the walk.
+template<class F>
+void dot11ForEachIe(const uint8_t* f, size_t len, F fn) {
+    if (len < DOT11_HEADER_SIZE + DOT11_BEACON_FIXED + DOT11_FCS_SIZE) return;
+    size_t end = len - DOT11_FCS_SIZE;
+    size_t pos = DOT11_HEADER_SIZE + DOT11_BEACON_FIXED;
+    while (pos + 2 <= end) {
+        uint8_t tag = f[pos], ieLen = f[pos + 1];
+        if (pos + 2 + ieLen > end) return;
+        if (!fn(tag, f + pos + 2, ieLen)) return;
+        pos += 2 + ieLen;
+    }
+}
+
+struct Dot11BeaconInfo {
+    const uint8_t* ssid;  // Not terminated, nullptr if absent
+    uint8_t ssidLen;
+    uint8_t channel;      // From the DS parameter set, 0 if absent
+};
+
+static inline Dot11BeaconInfo dot11BeaconInfo(const uint8_t* f, size_t len) {
+    Dot11BeaconInfo info = { nullptr, 0, 0 };
+    dot11ForEachIe(f, len, [&](uint8_t tag, const uint8_t* data, uint8_t ieLen) {
+        if (tag == DOT11_IE_SSID && ieLen <= 32 && !info.ssid) {
+            info.ssid = data;
+            info.ssidLen = ieLen;
+        } else if (tag == DOT11_IE_DS_PARAMS && ieLen == 1) {
+            info.channel = data[0];
+        }
+        return !(info.ssid && info.channel);
+    });
+    return info;
+}
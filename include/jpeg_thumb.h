@@ -0,0 +1,74 @@
+#pragma once
+
+// 1/8 or 1/4 scale luma thumbnail straight from a camera JPEG.
+//
+// Uses the tjpgd decoder in the ESP32 ROM with a static workspace - no
+// allocation. At scale 3 (1/8) it only needs the DC coefficient of each 8x8
+// block; scale 2 (1/4) costs a reduced IDCT but keeps 4x the pixels, for
+// frames small enough that 1/8 leaves too few per motion grid block.
+// One decode at a time per firmware.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp32/rom/tjpgd.h"
+
+// UXGA / 8, or SVGA / 4
+#define THUMB_MAX_W 200
+#define THUMB_MAX_H 150
+#define JPEG_WORKSPACE_SIZE 3100  // tjpgd ROM decoder work area
+
+struct JpegThumb {
+    uint8_t* luma;     // THUMB_MAX_W * THUMB_MAX_H bytes, caller-owned
+    uint16_t w;
+    uint16_t h;
+    const uint8_t* src;
+    size_t len;
+    size_t pos;
+};
+
+static uint8_t jpegWorkspace[JPEG_WORKSPACE_SIZE];
+
+static inline uint32_t jpegThumbRead(JDEC* jd, uint8_t* buf, uint32_t len) {
+    JpegThumb* t = (JpegThumb*)jd->device;
+    if (len > t->len - t->pos) len = t->len - t->pos;
+    if (buf) memcpy(buf, t->src + t->pos, len);
+    t->pos += len;
+    return len;
+}
+
+static inline uint32_t jpegThumbWrite(JDEC* jd, void* bitmap, JRECT* rect) {
+    JpegThumb* t = (JpegThumb*)jd->device;
+    const uint8_t* rgb = (const uint8_t*)bitmap;
+    for (uint16_t y = rect->top; y <= rect->bottom; y++) {
+        for (uint16_t x = rect->left; x <= rect->right; x++) {
+            if (x < t->w && y < t->h) {
+                t->luma[y * t->w + x] = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29) >> 8;
+            }
+            rgb += 3;
+        }
+    }
+    return 1;
+}
+
+#define THUMB_SCALE_8 3  // tjpgd scale codes: output is 1 / 2^scale
+#define THUMB_SCALE_4 2
+
+static inline bool jpegThumbDecode(JpegThumb* t, const uint8_t* jpeg, size_t len,
+                                   uint8_t scale = THUMB_SCALE_8) {
+    t->src = jpeg;
+    t->len = len;
+    t->pos = 0;
+
+    JDEC jd;
+    if (jd_prepare(&jd, jpegThumbRead, jpegWorkspace, sizeof(jpegWorkspace), t) != JDR_OK) {
+        return false;
+    }
+
+    uint16_t round = (1 << scale) - 1;
+    t->w = (jd.width + round) >> scale;
+    t->h = (jd.height + round) >> scale;
+    if (t->w > THUMB_MAX_W || t->h > THUMB_MAX_H) return false;
+
+    return jd_decomp(&jd, jpegThumbWrite, scale) == JDR_OK;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// Fixed-capacity map from MAC address (optionally tagged) to a small value
+// struct - mac_set.h with a value per key. Keys and values are separate
+// arrays in one caller-provided block, so probing only touches keys. O(1)
+// until ~3/4 full, after which new keys are refused; nothing allocates.
+//
+//   MacMap<ApInfo> aps;
+//   macMapInit(&aps, arenaAlloc(&psram, macMapBytes<ApInfo>(2048)), 2048);
+//   bool added;
+//   ApInfo* ap = macMapInsert(&aps, bssid, &added);  // nullptr when full
+
+#include "mac_set.h"
+
+template<class V>
+struct MacMap {
+    uint64_t* keys;     // capacity entries, zeroed
+    V* values;          // Zeroed when the key is added
+    uint32_t capacity;  // Power of two
+    uint32_t count;
+    uint32_t refused;   // Inserts rejected because the map was full
+};
+
+template<class V>
+static inline size_t macMapBytes(uint32_t capacity) {
+    return capacity * (sizeof(uint64_t) + sizeof(V));
+}
+
+template<class V>
+static inline void macMapInit(MacMap<V>* m, void* storage, uint32_t capacity) {
+    m->keys = (uint64_t*)storage;
+    m->values = storage ? (V*)(m->keys + capacity) : nullptr;
+    m->capacity = capacity;
+    m->count = 0;
+    m->refused = 0;
+    if (storage) memset(m->keys, 0, capacity * sizeof(uint64_t));
+}
+
+template<class V>
+static inline void macMapClear(MacMap<V>* m) {
+    macMapInit(m, m->keys, m->capacity);
+}
+
+// Slot of key, or of the empty slot where it would go
+template<class V>
+static inline uint32_t macMapSlot(const MacMap<V>* m, uint64_t key) {
+    uint32_t mask = m->capacity - 1;
+    uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (m->keys[i] && m->keys[i] != key) i = (i + 1) & mask;
+    return i;
+}
+
+template<class V>
+static inline V* macMapFind(MacMap<V>* m, const uint8_t* mac, uint8_t tag = 0) {
+    if (!m->keys) return nullptr;
+    uint32_t i = macMapSlot(m, macSetKey(mac, tag));
+    return m->keys[i] ? &m->values[i] : nullptr;
+}
+
+// The value for mac, added (zeroed, *added = true) if new; nullptr when
+// the map is full
+template<class V>
+static inline V* macMapInsert(MacMap<V>* m, const uint8_t* mac, bool* added, uint8_t tag = 0) {
+    *added = false;
+    if (!m->keys) return nullptr;
+    uint64_t key = macSetKey(mac, tag);
+    uint32_t i = macMapSlot(m, key);
+    if (m->keys[i]) return &m->values[i];
+    if ((m->count + 1) * 4 > m->capacity * 3) {
+        m->refused++;
+        return nullptr;
+    }
+    m->keys[i] = key;
+    memset(&m->values[i], 0, sizeof(V));
+    m->count++;
+    *added = true;
+    return &m->values[i];
+}
+
+// Calls fn(mac, value) for every entry
+template<class V, class F>
+void macMapForEach(MacMap<V>* m, F fn) {
+    if (!m->keys) return;
+    for (uint32_t i = 0; i < m->capacity; i++) {
+        if (!m->keys[i]) continue;
+        uint8_t mac[6];
+        for (int b = 0; b < 6; b++) mac[b] = m->keys[i] >> (8 * b);
+        fn(mac, &m->values[i]);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Fixed-capacity set of MAC addresses (optionally tagged, e.g. with an
+// EAPOL message number or a table slot, below 0x8000) for dedup. Open addressing over caller-provided
+// storage, so it lives in an arena and never allocates: insert is O(1)
+// until the table is ~3/4 full, after which new keys are refused.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MAC_SET_USED (1ULL << 63)  // Marks an occupied slot (a key is never 0)
+
+struct MacSet {
+    uint64_t* slots;    // capacity entries, zeroed
+    uint32_t capacity;  // Power of two
+    uint32_t count;
+    uint32_t refused;   // Inserts rejected because the table was full
+};
+
+static inline size_t macSetBytes(uint32_t capacity) {
+    return capacity * sizeof(uint64_t);
+}
+
+static inline void macSetInit(MacSet* s, void* storage, uint32_t capacity) {
+    s->slots = (uint64_t*)storage;
+    s->capacity = capacity;
+    s->count = 0;
+    s->refused = 0;
+    if (storage) memset(storage, 0, macSetBytes(capacity));
+}
+
+static inline void macSetClear(MacSet* s) {
+    macSetInit(s, s->slots, s->capacity);
+}
+
+static inline uint64_t macSetKey(const uint8_t* mac, uint16_t tag) {
+    uint64_t k = MAC_SET_USED | ((uint64_t)tag << 48);
+    for (int i = 0; i < 6; i++) k |= (uint64_t)mac[i] << (8 * i);
+    return k;
+}
+
+// Returns true if the key was added, false if already present or full
+static inline bool macSetInsert(MacSet* s, const uint8_t* mac, uint16_t tag = 0) {
+    if (!s->slots) return false;
+    uint64_t key = macSetKey(mac, tag);
+    uint32_t mask = s->capacity - 1;
+    uint32_t i = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (s->slots[i]) {
+        if (s->slots[i] == key) return false;
+        i = (i + 1) & mask;
+    }
+    if ((s->count + 1) * 4 > s->capacity * 3) {
+        s->refused++;
+        return false;
+    }
+    s->slots[i] = key;
+    s->count++;
+    return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Each passive firmware (sniffer, motion, stream) is still a standalone
+// setup()/loop() program. Wrapping its body in MODULE_BEGIN/MODULE_END puts
+// it in its own namespace when built into the multi-mode image (multi.cpp),
+// so the same source provides <name>::setup(), loop() and teardown().
+
+#ifdef ESPKIT_MULTI
+#define MODULE_BEGIN(name) namespace name {
+#define MODULE_END }
+#else
+#define MODULE_BEGIN(name)
+#define MODULE_END
+#endif
@@ -0,0 +1,158 @@
+#pragma once
+
+// Block-grid motion model.
+//
+// A luma thumbnail of the frame is split into MOTION_GRID_COLS x MOTION_GRID_ROWS
+// blocks. Each block keeps an exponentially-weighted background mean; a block
+// fires when its current mean moves further than its own threshold away from
+// the background (after removing the frame-wide lighting shift).
+//
+// Plain C++ with no Arduino dependencies so host tools can build it natively.
+// All state lives in the MotionGrid struct - callers place it wherever they
+// like (the motion firmware puts it in a PSRAM arena) and nothing allocates.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef MOTION_GRID_COLS
+#define MOTION_GRID_COLS 16
+#endif
+#ifndef MOTION_GRID_ROWS
+#define MOTION_GRID_ROWS 12
+#endif
+#define MOTION_GRID_BLOCKS (MOTION_GRID_COLS * MOTION_GRID_ROWS)
+
+// Detector defaults, shared by the firmware and tools/motion-bench
+#ifndef MOTION_THRESHOLD
+#define MOTION_THRESHOLD 20     // Per-block luma delta (0-255)
+#endif
+#ifndef MOTION_MIN_BLOCKS
+#define MOTION_MIN_BLOCKS 2     // Blocks that must fire to trigger
+#endif
+
+// Background follows 1/2^N of every new frame; fired blocks adapt 8x slower
+// so a moving object does not burn into the background.
+#ifndef MOTION_EWMA_SHIFT
+#define MOTION_EWMA_SHIFT 4
+#endif
+#define MOTION_EWMA_FIRED_SHIFT (MOTION_EWMA_SHIFT + 3)
+
+#define MOTION_BLOCK_MASKED 0  // threshold value for an ignored block
+
+struct MotionGrid {
+    uint16_t background[MOTION_GRID_BLOCKS];  // block luma, 8.8 fixed point
+    uint8_t threshold[MOTION_GRID_BLOCKS];    // luma delta to fire, 0 = masked
+    uint8_t fired[(MOTION_GRID_BLOCKS + 7) / 8];
+    uint32_t sum[MOTION_GRID_BLOCKS];         // per-frame scratch
+    uint16_t count[MOTION_GRID_BLOCKS];
+    uint16_t firedCount;
+    uint8_t maxDelta;                         // largest block delta last frame
+    int32_t lightShift;                       // frame-wide luma shift, 8.8
+    bool primed;
+};
+
+static inline bool motionGridBlockFired(const MotionGrid* g, uint16_t block) {
+    return g->fired[block >> 3] & (1 << (block & 7));
+}
+
+static inline void motionGridInit(MotionGrid* g, uint8_t defaultThreshold) {
+    memset(g, 0, sizeof(*g));
+    memset(g->threshold, defaultThreshold, sizeof(g->threshold));
+}
+
+// Region mask / threshold map: MOTION_GRID_ROWS lines of MOTION_GRID_COLS chars.
+//   '.'      block ignored
+//   '#'      default threshold
+//   '1'-'9'  threshold of digit * 4 luma levels
+// Short lines or a short file leave the remaining blocks at their current value.
+// Returns the number of blocks that were set.
+static inline uint16_t motionGridLoadMask(MotionGrid* g, const char* text, size_t len,
+                                          uint8_t defaultThreshold) {
+    uint16_t row = 0, col = 0, set = 0;
+    for (size_t i = 0; i < len && row < MOTION_GRID_ROWS; i++) {
+        char c = text[i];
+        if (c == '\r') continue;
+        if (c == '\n') {
+            row++;
+            col = 0;
+            continue;
+        }
+        if (col >= MOTION_GRID_COLS) continue;
+
+        uint16_t b = row * MOTION_GRID_COLS + col++;
+        if (c == '.') g->threshold[b] = MOTION_BLOCK_MASKED;
+        else if (c >= '1' && c <= '9') g->threshold[b] = (c - '0') * 4;
+        else g->threshold[b] = defaultThreshold;
+        set++;
+    }
+    return set;
+}
+
+// Feed one w x h luma thumbnail. The first frame primes the background.
+// Returns the number of blocks that fired.
+static inline uint16_t motionGridFeed(MotionGrid* g, const uint8_t* luma, uint16_t w, uint16_t h) {
+    memset(g->sum, 0, sizeof(g->sum));
+    memset(g->count, 0, sizeof(g->count));
+    memset(g->fired, 0, sizeof(g->fired));
+    g->firedCount = 0;
+    g->maxDelta = 0;
+    if (w < MOTION_GRID_COLS || h < MOTION_GRID_ROWS) return 0;
+
+    for (uint16_t y = 0; y < h; y++) {
+        uint32_t rowBase = (uint32_t)(y * MOTION_GRID_ROWS / h) * MOTION_GRID_COLS;
+        const uint8_t* px = luma + (uint32_t)y * w;
+        for (uint16_t x = 0; x < w; x++) {
+            uint32_t b = rowBase + x * MOTION_GRID_COLS / w;
+            g->sum[b] += px[x];
+            g->count[b]++;
+        }
+    }
+
+    // Block means, 8.8 fixed point, kept in sum[]
+    for (uint16_t b = 0; b < MOTION_GRID_BLOCKS; b++) {
+        g->sum[b] = (g->sum[b] << 8) / g->count[b];
+    }
+
+    if (!g->primed) {
+        for (uint16_t b = 0; b < MOTION_GRID_BLOCKS; b++) g->background[b] = g->sum[b];
+        g->lightShift = 0;
+        g->primed = true;
+        return 0;
+    }
+
+    // Lighting changes move every block together - measure and remove that
+    int32_t shiftSum = 0;
+    uint16_t watched = 0;
+    for (uint16_t b = 0; b < MOTION_GRID_BLOCKS; b++) {
+        if (g->threshold[b] == MOTION_BLOCK_MASKED) continue;
+        shiftSum += (int32_t)g->sum[b] - g->background[b];
+        watched++;
+    }
+    g->lightShift = watched ? shiftSum / watched : 0;
+
+    for (uint16_t b = 0; b < MOTION_GRID_BLOCKS; b++) {
+        int32_t cur = g->sum[b];
+        int32_t bg = g->background[b];
+        bool hit = false;
+
+        if (g->threshold[b] != MOTION_BLOCK_MASKED) {
+            int32_t d = cur - bg - g->lightShift;
+            if (d < 0) d = -d;
+            d >>= 8;
+            if (d > 255) d = 255;
+            if (d > g->maxDelta) g->maxDelta = d;
+            if (d > g->threshold[b]) {
+                g->fired[b >> 3] |= 1 << (b & 7);
+                g->firedCount++;
+                hit = true;
+            }
+        }
+
+        int32_t step = cur - bg;
+        step = hit ? step / (1 << MOTION_EWMA_FIRED_SHIFT) : step / (1 << MOTION_EWMA_SHIFT);
+        g->background[b] = bg + step;
+    }
+
+    return g->firedCount;
+}
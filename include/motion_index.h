@@ -0,0 +1,86 @@
+#pragma once
+
+// Append-only motion event index (/motion/events.idx).
+//
+// A 16-byte header followed by fixed 96-byte records, one per motion event,
+// so the device and host tools can list events by reading one file instead of
+// walking the shard directories. Framing is record_frame.h: a torn tail
+// record from a power cut is simply skipped, and the writer re-aligns the
+// file before appending. The zero padding it writes, like the zero-filled
+// tail FAT can leave after a power cut, checksums to 0 as well, so records
+// with neither a time nor an uptime are rejected too.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "motion_grid.h"
+#include "record_frame.h"
+
+#define MOTION_INDEX_MAGIC "MEVT"
+#define MOTION_INDEX_VERSION 1
+#define MOTION_INDEX_HEADER_SIZE RECORD_HEADER_SIZE
+#define MOTION_INDEX_FILE_LEN 58
+#define MOTION_EVENT_CLOCK_SET 0x01  // time is wall clock, not seconds since boot
+
+struct MotionIndexHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint8_t gridCols;
+    uint8_t gridRows;
+    uint8_t reserved[6];
+};
+
+struct MotionEventRecord {
+    uint32_t time;                     // time() at the trigger
+    uint32_t uptimeMs;                 // millis() at the trigger
+    uint16_t firedCount;
+    uint8_t maxDelta;
+    uint8_t flags;
+    uint8_t fired[24];                 // Block bitmap, row-major
+    char file[MOTION_INDEX_FILE_LEN];  // Clip path relative to /motion
+    uint16_t check;
+};
+
+static_assert(sizeof(MotionIndexHeader) == MOTION_INDEX_HEADER_SIZE, "index header layout");
+static_assert(sizeof(MotionEventRecord) == 96, "index record layout");
+static_assert(MOTION_GRID_BLOCKS <= 24 * 8, "grid does not fit the index bitmap");
+
+static inline uint16_t motionIndexCheck(const MotionEventRecord* r) {
+    return recordCheck(r, offsetof(MotionEventRecord, check));
+}
+
+static inline void motionIndexSeal(MotionEventRecord* r) {
+    r->file[MOTION_INDEX_FILE_LEN - 1] = 0;
+    r->check = motionIndexCheck(r);
+}
+
+static inline bool motionIndexValid(const MotionEventRecord* r) {
+    return r->check == motionIndexCheck(r) && r->file[MOTION_INDEX_FILE_LEN - 1] == 0 &&
+           (r->time || r->uptimeMs);
+}
+
+static inline void motionIndexHeader(MotionIndexHeader* h) {
+    recordHeaderInit(h, MOTION_INDEX_MAGIC, MOTION_INDEX_VERSION, sizeof(MotionEventRecord));
+    h->gridCols = MOTION_GRID_COLS;
+    h->gridRows = MOTION_GRID_ROWS;
+}
+
+static inline bool motionIndexHeaderValid(const MotionIndexHeader* h) {
+    return recordHeaderValid(h, MOTION_INDEX_MAGIC, MOTION_INDEX_VERSION, sizeof(MotionEventRecord));
+}
+
+// Bytes of zero padding needed so the next append starts on a record boundary
+static inline size_t motionIndexPad(size_t fileSize) {
+    if (fileSize < MOTION_INDEX_HEADER_SIZE) return 0;
+    size_t tail = (fileSize - MOTION_INDEX_HEADER_SIZE) % sizeof(MotionEventRecord);
+    return tail ? sizeof(MotionEventRecord) - tail : 0;
+}
+
+static inline void motionIndexFromGrid(MotionEventRecord* r, const MotionGrid* g) {
+    r->firedCount = g->firedCount;
+    r->maxDelta = g->maxDelta;
+    memset(r->fired, 0, sizeof(r->fired));
+    memcpy(r->fired, g->fired, sizeof(g->fired));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Finds the intact prefix of a pcap capture: the global header plus every
+// complete record. A power cut between syncs can leave a torn record (or a
+// zero-filled tail) at the end; truncating to PcapScan::valid makes the file
+// readable again and safe to append to. Shared by the sniffer's boot-time
+// recovery and tools/pcap-repair.
+//
+// R is any callable size_t(size_t offset, uint8_t* buf, size_t len) that
+// reads from the file; buf is a scratch chunk of at least 64 bytes.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_GLOBAL_HEADER_SIZE 24
+#define PCAP_RECORD_HEADER_SIZE 16
+
+struct PcapScan {
+    size_t valid;      // Bytes to keep, 0 if the global header is torn or wrong
+    uint32_t records;  // Complete records within valid
+};
+
+static inline uint32_t pcapLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+template<class R>
+PcapScan pcapScan(R& read, size_t fileSize, uint8_t* buf, size_t bufSize) {
+    PcapScan s = { 0, 0 };
+    if (fileSize < PCAP_GLOBAL_HEADER_SIZE) return s;
+    if (read(0, buf, PCAP_GLOBAL_HEADER_SIZE) != PCAP_GLOBAL_HEADER_SIZE) return s;
+    if (pcapLe32(buf) != PCAP_MAGIC) return s;
+    uint32_t snaplen = pcapLe32(buf + 16);
+    s.valid = PCAP_GLOBAL_HEADER_SIZE;
+
+    // Records are parsed out of bufSize chunks, so this is one sequential read
+    size_t pos = PCAP_GLOBAL_HEADER_SIZE;
+    size_t chunkStart = 0, chunkLen = 0;
+    while (pos + PCAP_RECORD_HEADER_SIZE <= fileSize) {
+        if (pos < chunkStart || pos + PCAP_RECORD_HEADER_SIZE > chunkStart + chunkLen) {
+            size_t want = fileSize - pos < bufSize ? fileSize - pos : bufSize;
+            chunkStart = pos;
+            chunkLen = read(pos, buf, want);
+            if (chunkLen < PCAP_RECORD_HEADER_SIZE) break;
+        }
+        const uint8_t* h = buf + (pos - chunkStart);
+        uint32_t usec = pcapLe32(h + 4);
+        uint32_t incl = pcapLe32(h + 8);
+        uint32_t orig = pcapLe32(h + 12);
+        // Zero length also ends the scan: a zero-filled tail is not a record
+        if (usec >= 1000000 || incl == 0 || incl > snaplen || incl > orig) break;
+        if (pos + PCAP_RECORD_HEADER_SIZE + incl > fileSize) break;
+
+        pos += PCAP_RECORD_HEADER_SIZE + incl;
+        s.valid = pos;
+        s.records++;
+    }
+    return s;
+}
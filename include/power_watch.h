@@ -0,0 +1,336 @@
+#pragma once
+
+// Power and thermal watch, and a throttle governor.
+//
+// powerWatchInit() replaces the brownout disable at the top of setup(). The
+// detector stays on at POWER_BROWNOUT_LEVEL with its reset - and the IDF
+// interrupt that performs it - turned off, so a supply dip latches in the
+// RTC interrupt status instead of resetting the chip or going unnoticed.
+// powerWatchTick() polls that latch, samples the chip temperature, and every
+// POWER_LOG_MS prints a line and appends a row to POWER_WATCH_FILE.
+//
+// The latest sample is mirrored into RTC memory, which survives every reset
+// short of losing power, so after a watchdog, panic or brownout reset
+// powerWatchBegin() logs the reset reason next to what the previous run
+// last saw: uptime, temperature, supply dips, throttle level.
+//
+// The governor moves up a level when the temperature crosses a level's
+// threshold or the supply dips, and back down one level at a time after
+// POWER_CALM_MS without either. Each level caps the CPU clock and the share
+// of the firmware's throttled unit that goes through - camera frames in
+// stream and dvr, clip frames written in motion, SD write bursts in the
+// sniffer:
+//
+//   powerWatchBegin("frames");
+//   if (!powerAdmit()) { esp_camera_fb_return(fb); return; }
+//
+// Every unit refused is counted, so the log shows how much throughput the
+// governor gave up and how long it spent at each level.
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "FS.h"
+#include "SD_MMC.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/soc.h"
+
+#define POWER_WATCH_FILE "/power.csv"
+#define POWER_SAMPLE_MS 5000
+#define POWER_LOG_MS 60000
+#define POWER_CALM_MS 120000          // Quiet time before stepping down a level
+#define POWER_HYSTERESIS_C10 50       // Step down only 5 C below the level's threshold
+#define POWER_BROWNOUT_LEVEL 7        // 0..7, ~2.43 V .. ~2.80 V; the 3.0 V minimum is above all
+#define POWER_TEMP_NONE INT16_MIN     // No sensor on this chip
+#define POWER_MAGIC 0x50575231        // "PWR1"
+
+// Chips without the sensor read a constant 128 F - 53.3 C. The sensor counts
+// as present once any reading differs.
+#define POWER_TEMP_STUCK_C10 533
+
+struct PowerLevel {
+    const char* name;
+    int16_t enterC10;    // Raised to this level at or above this (0.1 C)
+    uint16_t cpuMhz;
+    uint8_t admitPct;    // Share of throttled units let through
+};
+
+static const PowerLevel POWER_LEVELS[] = {
+    { "normal",   POWER_TEMP_NONE, 240, 100 },
+    { "warm",     700,             240, 50 },
+    { "hot",      780,             160, 25 },
+    { "critical", 850,              80, 10 },
+};
+#define POWER_LEVEL_COUNT (sizeof(POWER_LEVELS) / sizeof(POWER_LEVELS[0]))
+
+// Kept across resets in RTC memory; magic is wrong after power loss
+struct PowerSnapshot {
+    uint32_t magic;
+    uint32_t boots;
+    uint32_t uptimeS;
+    uint32_t dips;
+    int16_t tempC10;
+    int16_t peakC10;
+    uint8_t level;
+};
+
+struct PowerWatch {
+    bool init;
+    bool begun;              // Sensor probed, boot row written
+    esp_reset_reason_t reason;
+    PowerSnapshot last;      // Previous run, magic 0 if unknown
+    const char* unit;        // What powerAdmit() gates, for the log
+    int16_t tempC10;         // Smoothed
+    int16_t peakC10;
+    uint32_t dips;           // Supply dips since boot
+    uint8_t level;
+    uint32_t levelAt;        // Entered the current level
+    uint32_t levelSince;     // levelMs counted up to here
+    uint32_t calmSince;      // Last heat or supply trigger
+    uint32_t levelMs[POWER_LEVEL_COUNT];
+    uint32_t admitAcc;
+    uint32_t offered;        // Units seen while throttled
+    uint32_t givenUp;
+    uint32_t lastSample;
+    uint32_t lastLog;
+};
+
+// Shared by every translation unit, like scheduler()
+inline PowerWatch& powerWatch() {
+    static PowerWatch w = {};
+    return w;
+}
+
+inline portMUX_TYPE& powerMux() {
+    static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+    return m;
+}
+
+inline PowerSnapshot& powerSnapshot() {
+    static RTC_NOINIT_ATTR PowerSnapshot s;
+    return s;
+}
+
+static inline const char* powerResetName(esp_reset_reason_t r) {
+    switch (r) {
+        case ESP_RST_POWERON: return "power-on";
+        case ESP_RST_EXT: return "external";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "interrupt-wdt";
+        case ESP_RST_TASK_WDT: return "task-wdt";
+        case ESP_RST_WDT: return "wdt";
+        case ESP_RST_DEEPSLEEP: return "deep-sleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        case ESP_RST_SDIO: return "sdio";
+        default: return "unknown";
+    }
+}
+
+// First thing in setup(): detector on in count-only mode, previous run saved
+static inline void powerWatchInit() {
+    PowerWatch& w = powerWatch();
+    if (w.init) return;
+    w.init = true;
+    w.reason = esp_reset_reason();
+    w.tempC10 = w.peakC10 = POWER_TEMP_NONE;
+
+    PowerSnapshot& s = powerSnapshot();
+    bool valid = s.magic == POWER_MAGIC;
+    if (valid && w.reason != ESP_RST_POWERON) w.last = s;
+    uint32_t boots = valid ? s.boots + 1 : 1;
+    memset(&s, 0, sizeof(s));
+    s.magic = POWER_MAGIC;
+    s.boots = boots;
+    s.tempC10 = s.peakC10 = POWER_TEMP_NONE;
+
+    CLEAR_PERI_REG_MASK(RTC_CNTL_INT_ENA_REG, RTC_CNTL_BROWN_OUT_INT_ENA_M);
+    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG,
+                   RTC_CNTL_BROWN_OUT_ENA | (POWER_BROWNOUT_LEVEL << RTC_CNTL_DBROWN_OUT_THRES_S));
+    WRITE_PERI_REG(RTC_CNTL_INT_CLR_REG, RTC_CNTL_BROWN_OUT_INT_CLR_M);
+}
+
+// True once per dip since the last call
+static inline bool powerDipped() {
+    if (!(READ_PERI_REG(RTC_CNTL_INT_RAW_REG) & RTC_CNTL_BROWN_OUT_INT_RAW_M)) return false;
+    WRITE_PERI_REG(RTC_CNTL_INT_CLR_REG, RTC_CNTL_BROWN_OUT_INT_CLR_M);
+    return true;
+}
+
+// "61.5", or none without a sensor
+static inline const char* powerTempText(int16_t c10, char* buf, size_t size, const char* none) {
+    if (c10 == POWER_TEMP_NONE) return none;
+    snprintf(buf, size, "%.1f", c10 / 10.0);
+    return buf;
+}
+
+// Smoothed into tempC10 - the raw sensor steps in whole degrees F and jitters
+static inline void powerSampleTemp() {
+    PowerWatch& w = powerWatch();
+    int16_t t = (int16_t)lroundf(temperatureRead() * 10);
+    if (w.tempC10 != POWER_TEMP_NONE) {
+        w.tempC10 += (t - w.tempC10) / 4;
+    } else if (t != POWER_TEMP_STUCK_C10) {
+        w.tempC10 = t;
+    } else {
+        return;
+    }
+    if (w.peakC10 == POWER_TEMP_NONE || w.tempC10 > w.peakC10) w.peakC10 = w.tempC10;
+}
+
+// Whether the caller's unit goes through at the current level; units are
+// spread evenly, e.g. every other one at 50%
+static inline bool powerAdmit() {
+    PowerWatch& w = powerWatch();
+    uint8_t pct = POWER_LEVELS[w.level].admitPct;
+    if (pct >= 100) return true;
+    portENTER_CRITICAL(&powerMux());
+    w.offered++;
+    w.admitAcc += pct;
+    bool admit = w.admitAcc >= 100;
+    if (admit) w.admitAcc -= 100;
+    else w.givenUp++;
+    portEXIT_CRITICAL(&powerMux());
+    return admit;
+}
+
+static inline void powerLog(uint32_t now, const char* event, const char* note) {
+    if (SD_MMC.cardType() == CARD_NONE) return;
+    File f = SD_MMC.open(POWER_WATCH_FILE, FILE_APPEND);
+    if (!f) return;
+    if (f.size() == 0) {
+        f.println("uptime_s,event,temp_c,peak_c,dips,level,cpu_mhz,offered,given_up,note");
+    }
+    const PowerWatch& w = powerWatch();
+    char temp[8], peak[8];
+    f.printf("%lu,%s,%s,%s,%lu,%s,%lu,%lu,%lu,\"%s\"\n", now / 1000, event,
+             powerTempText(w.tempC10, temp, sizeof(temp), ""),
+             powerTempText(w.peakC10, peak, sizeof(peak), ""), w.dips,
+             POWER_LEVELS[w.level].name, getCpuFrequencyMhz(), w.offered, w.givenUp, note);
+    f.close();
+}
+
+static inline void powerApplyCpu() {
+    uint16_t mhz = POWER_LEVELS[powerWatch().level].cpuMhz;
+    if (getCpuFrequencyMhz() != mhz) setCpuFrequencyMhz(mhz);
+}
+
+static inline void powerSetLevel(uint8_t level, uint32_t now, const char* why) {
+    PowerWatch& w = powerWatch();
+    uint8_t from = w.level;
+    uint32_t heldMs = now - w.levelAt;
+    w.levelMs[from] += now - w.levelSince;
+    w.level = level;
+    w.levelAt = w.levelSince = now;
+    powerApplyCpu();
+
+    const PowerLevel& l = POWER_LEVELS[level];
+    Serial.printf("[POWER] Level %s -> %s (%s) after %lu s | CPU %lu MHz | %s %u%% | gave up %lu of %lu\n",
+                  POWER_LEVELS[from].name, l.name, why, heldMs / 1000, getCpuFrequencyMhz(),
+                  w.unit ? w.unit : "-", l.admitPct, w.givenUp, w.offered);
+    char note[48];
+    snprintf(note, sizeof(note), "%s after %lu s at %s", why, heldMs / 1000, POWER_LEVELS[from].name);
+    powerLog(now, "level", note);
+}
+
+// After setup(), next to heapWatchBegin(). unit names what powerAdmit()
+// gates, nullptr where nothing is; called again by each module in the
+// multi image.
+static inline void powerWatchBegin(const char* unit) {
+    powerWatchInit();
+    PowerWatch& w = powerWatch();
+    uint32_t now = millis();
+    if (w.unit != unit) {
+        // New module in the multi image: count its own unit from zero
+        w.offered = w.givenUp = w.admitAcc = 0;
+        w.unit = unit;
+    }
+    w.lastSample = w.lastLog = now;
+    powerApplyCpu();
+    if (w.begun) return;
+    w.begun = true;
+    w.levelAt = w.levelSince = w.calmSince = now;
+
+    powerSampleTemp();
+
+    const PowerSnapshot& p = w.last;
+    char note[128];
+    if (p.magic) {
+        char prevTemp[8], prevPeak[8];
+        snprintf(note, sizeof(note), "reset %s; previous run %lu s, %s C (peak %s), %lu dips, %s",
+                 powerResetName(w.reason), p.uptimeS, powerTempText(p.tempC10, prevTemp, sizeof(prevTemp), "-"),
+                 powerTempText(p.peakC10, prevPeak, sizeof(prevPeak), "-"), p.dips,
+                 POWER_LEVELS[p.level < POWER_LEVEL_COUNT ? p.level : 0].name);
+    } else {
+        snprintf(note, sizeof(note), "reset %s", powerResetName(w.reason));
+    }
+    char temp[8];
+    Serial.printf("[POWER] Boot %lu: %s | Temp: %s C\n", powerSnapshot().boots, note,
+                  powerTempText(w.tempC10, temp, sizeof(temp), "-"));
+    powerLog(now, "boot", note);
+}
+
+static inline void powerReport(uint32_t now) {
+    PowerWatch& w = powerWatch();
+    w.levelMs[w.level] += now - w.levelSince;
+    w.levelSince = now;
+    char temp[8], peak[8];
+    Serial.printf("[POWER] %s C (peak %s) | Dips: %lu | Level: %s, CPU %lu MHz | Gave up %lu of %lu %s",
+                  powerTempText(w.tempC10, temp, sizeof(temp), "-"),
+                  powerTempText(w.peakC10, peak, sizeof(peak), "-"), w.dips, POWER_LEVELS[w.level].name,
+                  getCpuFrequencyMhz(), w.givenUp, w.offered, w.unit ? w.unit : "-");
+    for (uint8_t l = 1; l < POWER_LEVEL_COUNT; l++) {
+        if (w.levelMs[l]) Serial.printf(" | %s %lu s", POWER_LEVELS[l].name, w.levelMs[l] / 1000);
+    }
+    Serial.println();
+    powerLog(now, "sample", "");
+}
+
+// Polls the supply latch and temperature, moves the governor, logs. Call
+// from a scheduler event or loop(); rate-limited to POWER_SAMPLE_MS.
+static inline void powerWatchTick(uint32_t now) {
+    PowerWatch& w = powerWatch();
+    if (!w.begun || now - w.lastSample < POWER_SAMPLE_MS) return;
+    w.lastSample = now;
+
+    bool dipped = powerDipped();
+    if (dipped) {
+        w.dips++;
+        Serial.printf("[POWER] Supply dip #%lu\n", w.dips);
+        powerLog(now, "dip", "");
+    }
+    powerSampleTemp();
+    bool hasTemp = w.tempC10 != POWER_TEMP_NONE;
+
+    uint8_t target = 0;
+    for (uint8_t l = POWER_LEVEL_COUNT - 1; hasTemp && l > 0; l--) {
+        if (w.tempC10 >= POWER_LEVELS[l].enterC10) {
+            target = l;
+            break;
+        }
+    }
+    if (dipped && w.level + 1u < POWER_LEVEL_COUNT && target <= w.level) target = w.level + 1;
+
+    bool triggered = dipped || (target && target >= w.level);
+    if (target > w.level) {
+        powerSetLevel(target, now, dipped ? "supply dip" : "temperature");
+    } else if (!triggered && w.level > 0 && now - w.calmSince >= POWER_CALM_MS &&
+               (!hasTemp || w.tempC10 < POWER_LEVELS[w.level].enterC10 - POWER_HYSTERESIS_C10)) {
+        powerSetLevel(w.level - 1, now, "calm");
+        w.calmSince = now;  // Each further step waits its own POWER_CALM_MS
+    }
+    if (triggered) w.calmSince = now;
+
+    PowerSnapshot& s = powerSnapshot();
+    s.uptimeS = now / 1000;
+    s.dips = w.dips;
+    s.tempC10 = w.tempC10;
+    s.peakC10 = w.peakC10;
+    s.level = w.level;
+
+    if (now - w.lastLog >= POWER_LOG_MS) {
+        w.lastLog = now;
+        powerReport(now);
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+// Scoped hot-path probes on the Xtensa cycle counter.
+//
+//   void sniffer_callback(...) {
+//       PROBE("sniffer_callback");
+//       ...
+//   }
+//   PROBE_REPORT(millis());  // from a loop: dump every PROBE_DUMP_MS
+//
+// Each probe site keeps count / min / max / total cycles and a log2
+// histogram (bucket n holds durations of 2^n .. 2^(n+1)-1 cycles) in a
+// static table - nothing is allocated. Reports go to Serial and are
+// appended to PROBE_FILE on the SD card.
+//
+// Build with -DPROBE_ENABLED=1; otherwise the macros compile to nothing.
+// CCOUNT is per core: a scope preempted and resumed on the other core
+// reads garbage. Only probe code that stays on one core: pinned tasks,
+// which include the WiFi task and the callbacks it runs.
+
+#ifndef PROBE_ENABLED
+#define PROBE_ENABLED 0
+#endif
+
+#if PROBE_ENABLED
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <string.h>
+#include "FS.h"
+#include "SD_MMC.h"
+
+#define PROBE_MAX_SITES 16
+#define PROBE_BUCKETS 32
+#define PROBE_DUMP_MS 60000
+#define PROBE_FILE "/probes.txt"
+
+struct ProbeSite {
+    const char* name;
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t buckets[PROBE_BUCKETS];
+};
+
+struct ProbeTable {
+    ProbeSite sites[PROBE_MAX_SITES];
+    uint8_t used;
+    uint32_t overflow;  // Probe sites beyond PROBE_MAX_SITES, not recorded
+    portMUX_TYPE lock;
+};
+
+// Shared by every translation unit in the image
+inline ProbeTable& probeTable() {
+    static ProbeTable t = { {}, 0, 0, portMUX_INITIALIZER_UNLOCKED };
+    return t;
+}
+
+static inline uint32_t probeCycles() {
+    uint32_t c;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(c));
+    return c;
+}
+
+static inline ProbeSite* probeRegister(const char* name) {
+    ProbeTable& t = probeTable();
+    ProbeSite* site = nullptr;
+    portENTER_CRITICAL_SAFE(&t.lock);
+    if (t.used < PROBE_MAX_SITES) {
+        site = &t.sites[t.used++];
+        site->name = name;
+        site->minCycles = UINT32_MAX;
+    } else {
+        t.overflow++;
+    }
+    portEXIT_CRITICAL_SAFE(&t.lock);
+    return site;
+}
+
+static inline void probeRecord(ProbeSite* site, uint32_t cycles) {
+    if (!site) return;
+    uint8_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+    ProbeTable& t = probeTable();
+    portENTER_CRITICAL_SAFE(&t.lock);
+    site->count++;
+    site->totalCycles += cycles;
+    if (cycles < site->minCycles) site->minCycles = cycles;
+    if (cycles > site->maxCycles) site->maxCycles = cycles;
+    site->buckets[bucket]++;
+    portEXIT_CRITICAL_SAFE(&t.lock);
+}
+
+struct ProbeScope {
+    ProbeSite* site;
+    uint32_t start;
+    ProbeScope(ProbeSite* s) : site(s), start(probeCycles()) {}
+    ~ProbeScope() { probeRecord(site, probeCycles() - start); }
+};
+
+static inline void probeDump(Print& out) {
+    ProbeTable& t = probeTable();
+    float mhz = getCpuFrequencyMhz();
+    out.printf("[PROBE] %lu ms uptime, %.0f MHz, %u sites%s\n", millis(), mhz, t.used,
+               t.overflow ? " (table full, some not recorded)" : "");
+
+    for (uint8_t i = 0; i < t.used; i++) {
+        // Copy under the lock so the lines are consistent
+        ProbeSite s;
+        portENTER_CRITICAL(&t.lock);
+        s = t.sites[i];
+        portEXIT_CRITICAL(&t.lock);
+        if (!s.count) continue;
+
+        out.printf("[PROBE] %s: n=%lu min=%.1f avg=%.1f max=%.1f us\n", s.name, s.count,
+                   s.minCycles / mhz, (float)(s.totalCycles / s.count) / mhz, s.maxCycles / mhz);
+        for (uint8_t b = 0; b < PROBE_BUCKETS; b++) {
+            if (!s.buckets[b]) continue;
+            uint8_t bar = (uint64_t)s.buckets[b] * 40 / s.count;
+            char bars[41];
+            memset(bars, '#', bar);
+            bars[bar] = 0;
+            out.printf("[PROBE]   %9.1f - %9.1f us %8lu %s\n",
+                       (1UL << b) / mhz, (b < 31 ? (1UL << (b + 1)) : UINT32_MAX) / mhz,
+                       s.buckets[b], bars);
+        }
+    }
+}
+
+static inline void probeDumpFile(const char* path) {
+    File f = SD_MMC.open(path, FILE_APPEND);
+    if (!f) return;
+    probeDump(f);
+    f.close();
+}
+
+static inline void probeReportIfDue(uint32_t now) {
+    static uint32_t last = 0;
+    if (now - last < PROBE_DUMP_MS) return;
+    last = now;
+    probeDump(Serial);
+    probeDumpFile(PROBE_FILE);
+}
+
+#define PROBE_CONCAT2(a, b) a##b
+#define PROBE_CONCAT(a, b) PROBE_CONCAT2(a, b)
+#define PROBE(name) \
+    static ProbeSite* PROBE_CONCAT(probeSite_, __LINE__) = probeRegister(name); \
+    ProbeScope PROBE_CONCAT(probeScope_, __LINE__)(PROBE_CONCAT(probeSite_, __LINE__))
+#define PROBE_REPORT(now) probeReportIfDue(now)
+
+#else
+
+#define PROBE(name) do {} while (0)
+#define PROBE_REPORT(now) do {} while (0)
+
+#endif
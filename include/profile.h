@@ -0,0 +1,97 @@
+#pragma once
+
+// Build profiles: the capture and camera tunables as compile-time constants,
+// one set per profile, picked per PlatformIO env:
+//
+//   build_flags = -DESPKIT_PROFILE_MAX      ; max throughput
+//   build_flags = -DESPKIT_PROFILE_LOWMEM   ; low memory
+//   (neither)                               ; default
+//
+// Code reads CaptureProfile::x / CameraProfile::x (or a macro defined from
+// them), and the sniffer callback is a template over CaptureProfile, so a
+// feature a profile turns off is folded out of the hot path rather than
+// tested per frame.
+
+#include <stdint.h>
+#include "esp_wifi_types.h"
+
+#if CONFIG_ESP32_CAMERA_ENABLED
+#include "esp_camera.h"
+#endif
+
+// Sniffer
+struct CaptureDefault {
+    static constexpr const char* name = "default";
+    static constexpr uint32_t pcapBuffer = 4096;          // SD write size, internal DMA RAM
+    static constexpr uint32_t burstRing = 3 * 1024 * 1024;  // PSRAM, 0: write directly
+    static constexpr uint32_t maxAps = 2048;              // BSSIDs reported as [NEW]
+    static constexpr uint32_t clientBss = 512;            // Client activity tables, per bank
+    static constexpr uint32_t clientStations = 2048;
+    static constexpr uint32_t frameTypes = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA;
+    static constexpr bool ledActivity = true;             // LED on GPIO 33 per frame
+    static constexpr bool metrics = true;                 // Frame counter, burst log
+};
+
+// Larger SD writes, no per-frame GPIO or counters
+struct CaptureMax : CaptureDefault {
+    static constexpr const char* name = "max-throughput";
+    static constexpr uint32_t pcapBuffer = 16384;
+    static constexpr bool ledActivity = false;
+    static constexpr bool metrics = false;
+};
+
+// Management frames only (beacons, probes, auth), small ring and tables
+struct CaptureLowMem : CaptureDefault {
+    static constexpr const char* name = "low-memory";
+    static constexpr uint32_t pcapBuffer = 3072;
+    static constexpr uint32_t burstRing = 256 * 1024;
+    static constexpr uint32_t maxAps = 512;
+    static constexpr uint32_t clientBss = 128;
+    static constexpr uint32_t clientStations = 512;
+    static constexpr uint32_t frameTypes = WIFI_PROMIS_FILTER_MASK_MGMT;
+};
+
+#if CONFIG_ESP32_CAMERA_ENABLED
+// motion and stream
+struct CameraDefault {
+    static constexpr framesize_t detectFrameSize = FRAMESIZE_QVGA;
+    static constexpr framesize_t captureFrameSize = FRAMESIZE_SVGA;
+    static constexpr uint8_t prerollFrames = 16;
+    static constexpr uint8_t captureQuality = 12;
+    static constexpr uint32_t aviWriteBuffer = 32768;     // Internal DMA RAM
+    static constexpr framesize_t streamFrameSize = FRAMESIZE_VGA;
+    static constexpr uint8_t streamQuality = 10;
+    static constexpr uint8_t streamFbCount = 2;
+};
+
+// Bigger AVI writes, a third stream buffer so capture never waits on send
+struct CameraMax : CameraDefault {
+    static constexpr uint32_t aviWriteBuffer = 65536;
+    static constexpr uint8_t streamFbCount = 3;
+};
+
+// VGA clips with a shorter pre-roll, single stream buffer
+struct CameraLowMem : CameraDefault {
+    static constexpr framesize_t captureFrameSize = FRAMESIZE_VGA;
+    static constexpr uint8_t prerollFrames = 6;
+    static constexpr uint32_t aviWriteBuffer = 16384;
+    static constexpr uint8_t streamFbCount = 1;
+};
+#endif
+
+#if defined(ESPKIT_PROFILE_MAX)
+typedef CaptureMax CaptureProfile;
+#if CONFIG_ESP32_CAMERA_ENABLED
+typedef CameraMax CameraProfile;
+#endif
+#elif defined(ESPKIT_PROFILE_LOWMEM)
+typedef CaptureLowMem CaptureProfile;
+#if CONFIG_ESP32_CAMERA_ENABLED
+typedef CameraLowMem CameraProfile;
+#endif
+#else
+typedef CaptureDefault CaptureProfile;
+#if CONFIG_ESP32_CAMERA_ENABLED
+typedef CameraDefault CameraProfile;
+#endif
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+// Framing shared by the record files kept on SD - the motion event index
+// (motion_index.h), channel survey (survey.h) and client activity
+// (client_stats.h).
+//
+// Each file is a 16-byte header - magic, version, record size, then 8 bytes
+// of the format's own - followed by fixed-size records that end in a
+// Fletcher-16 check. A torn tail record from a power cut fails its check and
+// readers skip it. An all-zero record checks to 0, so each format also needs
+// a field that is never zero in a real record.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define RECORD_HEADER_SIZE 16
+
+// Fletcher-16 over the len bytes before the record's check field
+static inline uint16_t recordCheck(const void* r, size_t len) {
+    const uint8_t* p = (const uint8_t*)r;
+    uint16_t a = 0, b = 0;
+    for (size_t i = 0; i < len; i++) {
+        a = (a + p[i]) % 255;
+        b = (b + a) % 255;
+    }
+    return (b << 8) | a;
+}
+
+// H is any header starting with char magic[4], uint16_t version and
+// uint16_t recordSize; the remaining bytes are left zero for the caller
+template <typename H>
+static inline void recordHeaderInit(H* h, const char* magic, uint16_t version, uint16_t recordSize) {
+    static_assert(sizeof(H) == RECORD_HEADER_SIZE, "record header layout");
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, magic, 4);
+    h->version = version;
+    h->recordSize = recordSize;
+}
+
+template <typename H>
+static inline bool recordHeaderValid(const H* h, const char* magic, uint16_t version, uint16_t recordSize) {
+    return memcmp(h->magic, magic, 4) == 0 && h->version == version && h->recordSize == recordSize;
+}
+
+// Counts that are wider while accumulating than in the record
+static inline uint16_t recordSat16(uint32_t v) {
+    return v > 0xffff ? 0xffff : v;
+}
+
+static inline uint32_t recordSat32(uint64_t v) {
+    return v > 0xffffffffULL ? 0xffffffff : (uint32_t)v;
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+// Timed events for loop(): FreeRTOS software timers that wake the loop task
+// through task notifications, instead of delay()-paced loop bodies.
+//
+//   int hop = schedEvery("hop", 250, hopChannel);
+//   int led = schedEvent("led", ledStep);   // unarmed until schedAfter()
+//   void loop() { schedRun(); }
+//
+// A timer callback only sets the event's notification bit; handlers run in
+// the loop task, in registration order, so they may block on SD or Serial
+// like the old loop bodies did. Between events the loop task sleeps in
+// xTaskNotifyWait. Periodic timers fire on the tick grid rather than after
+// "work + delay", so a slow handler delays the next run but not every one
+// after it.
+//
+// Each event tracks how late its handler started against the ideal time and
+// how long it ran; schedReport() prints them with the loop task's busy time.
+// Handlers get millis() at dispatch.
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_timer.h"
+
+#define SCHED_MAX_EVENTS 16
+
+// multi.cpp polls Serial and the mode button between module loops
+#ifdef ESPKIT_MULTI
+#define SCHED_MAX_WAIT_MS 50
+#define SCHED_MAX_WAIT pdMS_TO_TICKS(SCHED_MAX_WAIT_MS)
+#else
+#define SCHED_MAX_WAIT portMAX_DELAY
+#endif
+
+typedef void (*SchedFn)(uint32_t now);
+
+struct SchedEvent {
+    const char* name;
+    SchedFn fn;
+    TimerHandle_t timer;
+    uint32_t periodMs;  // 0: one-shot
+    int64_t dueUs;      // Ideal start of the next run, 0 when unarmed
+    uint32_t runs;
+    uint32_t missed;    // Periodic runs that fell a whole period behind
+    uint64_t lateSumUs;
+    uint32_t lateMaxUs;
+    uint64_t busyUs;
+};
+
+struct Scheduler {
+    SchedEvent events[SCHED_MAX_EVENTS];
+    uint8_t count;
+    TaskHandle_t runner;
+    int64_t startUs;
+    uint64_t busyUs;
+};
+
+// One scheduler per image (the loop task's), shared by every translation unit
+inline Scheduler& scheduler() {
+    static Scheduler s = {};
+    return s;
+}
+
+static inline void schedTimerFired(TimerHandle_t t) {
+    uint32_t id = (uint32_t)(uintptr_t)pvTimerGetTimerID(t);
+    xTaskNotify(scheduler().runner, 1UL << id, eSetBits);
+}
+
+static inline int schedAdd(const char* name, uint32_t periodMs, SchedFn fn) {
+    Scheduler& s = scheduler();
+    if (s.count >= SCHED_MAX_EVENTS) return -1;
+    if (!s.count) {
+        s.runner = xTaskGetCurrentTaskHandle();
+        s.startUs = esp_timer_get_time();
+        s.busyUs = 0;
+    }
+    int id = s.count;
+    SchedEvent& e = s.events[id];
+    e = SchedEvent();
+    e.name = name;
+    e.fn = fn;
+    e.periodMs = periodMs;
+    e.timer = xTimerCreate(name, pdMS_TO_TICKS(periodMs ? periodMs : 1), periodMs ? pdTRUE : pdFALSE,
+                           (void*)(uintptr_t)id, schedTimerFired);
+    if (!e.timer) return -1;
+    s.count++;
+    return id;
+}
+
+// Runs fn every periodMs, starting one period from now. Call from the task
+// that calls schedRun() (setup() and loop() share the loop task).
+static inline int schedEvery(const char* name, uint32_t periodMs, SchedFn fn) {
+    int id = schedAdd(name, periodMs, fn);
+    if (id < 0) return id;
+    SchedEvent& e = scheduler().events[id];
+    e.dueUs = esp_timer_get_time() + (int64_t)periodMs * 1000;
+    xTimerStart(e.timer, portMAX_DELAY);
+    return id;
+}
+
+// A one-shot event, armed with schedAfter()
+static inline int schedEvent(const char* name, SchedFn fn) {
+    return schedAdd(name, 0, fn);
+}
+
+// (Re)arms a one-shot event; an armed one is pushed back to delayMs from now
+static inline void schedAfter(int id, uint32_t delayMs) {
+    if (id < 0) return;
+    SchedEvent& e = scheduler().events[id];
+    if (!delayMs) delayMs = 1;
+    e.dueUs = esp_timer_get_time() + (int64_t)delayMs * 1000;
+    xTimerChangePeriod(e.timer, pdMS_TO_TICKS(delayMs), portMAX_DELAY);  // Also starts it
+}
+
+// Restarts a periodic event with a new period, first run one period from now
+static inline void schedSetPeriod(int id, uint32_t periodMs) {
+    if (id < 0 || !periodMs) return;
+    SchedEvent& e = scheduler().events[id];
+    if (!e.periodMs) return;
+    e.periodMs = periodMs;
+    e.dueUs = esp_timer_get_time() + (int64_t)periodMs * 1000;
+    xTimerChangePeriod(e.timer, pdMS_TO_TICKS(periodMs), portMAX_DELAY);
+}
+
+// Sleeps until at least one event is due (or SCHED_MAX_WAIT passed), then
+// runs the due handlers
+static inline void schedRun(TickType_t maxWait = SCHED_MAX_WAIT) {
+    Scheduler& s = scheduler();
+    uint32_t bits = 0;
+    if (xTaskNotifyWait(0, UINT32_MAX, &bits, maxWait) != pdTRUE) return;
+
+    for (uint8_t id = 0; id < s.count; id++) {
+        if (!(bits & (1UL << id))) continue;
+        SchedEvent& e = s.events[id];
+        int64_t start = esp_timer_get_time();
+        if (e.dueUs) {
+            int64_t late = start - e.dueUs;
+            if (late < 0) late = 0;
+            e.lateSumUs += late;
+            if (late > e.lateMaxUs) e.lateMaxUs = late;
+            if (e.periodMs) {
+                e.dueUs += (int64_t)e.periodMs * 1000;
+                if (start - e.dueUs > 0) {
+                    // Whole periods lost: resync instead of counting them as late
+                    e.missed += (start - e.dueUs) / ((int64_t)e.periodMs * 1000) + 1;
+                    e.dueUs = start + (int64_t)e.periodMs * 1000;
+                }
+            } else {
+                e.dueUs = 0;
+            }
+        }
+        e.fn(millis());
+        int64_t busy = esp_timer_get_time() - start;
+        e.runs++;
+        e.busyUs += busy;
+        s.busyUs += busy;
+    }
+}
+
+static inline void schedReport(Print& out) {
+    Scheduler& s = scheduler();
+    int64_t elapsed = esp_timer_get_time() - s.startUs;
+    out.printf("[SCHED] Loop task busy %.2f%% of %lu s\n",
+               elapsed > 0 ? s.busyUs * 100.0 / elapsed : 0.0, (uint32_t)(elapsed / 1000000));
+    for (uint8_t id = 0; id < s.count; id++) {
+        const SchedEvent& e = s.events[id];
+        if (!e.runs) continue;
+        out.printf("[SCHED] %-8s n=%lu late avg %lu max %lu us | run avg %lu us | missed %lu\n",
+                   e.name, e.runs, (uint32_t)(e.lateSumUs / e.runs), e.lateMaxUs,
+                   (uint32_t)(e.busyUs / e.runs), e.missed);
+    }
+}
+
+// Deletes every event, e.g. on module teardown
+static inline void schedStop() {
+    Scheduler& s = scheduler();
+    for (uint8_t id = 0; id < s.count; id++) xTimerDelete(s.events[id].timer, portMAX_DELAY);
+    s.count = 0;
+    xTaskNotifyWait(0, UINT32_MAX, nullptr, 0);  // Drop bits already posted
+}
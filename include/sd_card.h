@@ -0,0 +1,50 @@
+#pragma once
+
+// SD_MMC mount shared by every firmware.
+//
+// 1-bit mode (default) uses CLK/CMD/D0 = GPIO 14/15/2. 4-bit mode adds
+// D1/D2/D3 = GPIO 4/12/13, roughly doubling throughput, but on the ESP32-CAM:
+// - GPIO 4 also drives the flash LED, which then flickers with SD traffic
+// - GPIO 12 is the flash-voltage strap; the card's pull-up on D2 makes the
+//   module fail to boot unless the strap is fixed once with
+//   `espefuse.py set_flash_voltage 3.3V`
+// - GPIO 13 is no longer free for a button
+//
+// Select with -DSD_4BIT=1 in build_flags. A failed 4-bit mount falls back
+// to 1-bit so a missing pull-up costs speed, not storage.
+
+#include <Arduino.h>
+#include "FS.h"
+#include "SD_MMC.h"
+
+#ifndef SD_4BIT
+#define SD_4BIT 0
+#endif
+#ifndef SD_FREQ_KHZ
+#define SD_FREQ_KHZ SDMMC_FREQ_DEFAULT  // 20 MHz; SDMMC_FREQ_HIGHSPEED is 40 MHz
+#endif
+
+#define SD_MOUNT_POINT "/sdcard"
+#define SD_FLASH_LED_PIN 4
+
+static uint8_t sdWidth = 0;  // Bus width actually mounted, 0 when not mounted
+
+static inline bool sdBeginWidth(uint8_t width) {
+    if (!SD_MMC.begin(SD_MOUNT_POINT, width == 1, false, SD_FREQ_KHZ)) return false;
+    sdWidth = width;
+    if (width == 1) {
+        // D1 is unused in 1-bit mode - keep the flash LED off
+        pinMode(SD_FLASH_LED_PIN, OUTPUT);
+        digitalWrite(SD_FLASH_LED_PIN, LOW);
+    }
+    return true;
+}
+
+static inline bool sdBegin() {
+#if SD_4BIT
+    if (sdBeginWidth(4)) return true;
+    Serial.println("[SD] 4-bit mount failed, retrying 1-bit");
+    SD_MMC.end();
+#endif
+    return sdBeginWidth(1);
+}
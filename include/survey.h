@@ -0,0 +1,173 @@
+#pragma once
+
+// Channel survey: per-channel statistics accumulated on the device and
+// written as one fixed 64-byte record per channel per interval
+// (/survey/<timestamp>.srv), instead of every frame as pcap. A minute-long
+// interval over 13 channels is ~830 bytes, so a week fits in ~8 MB.
+//
+// Framing is record_frame.h, like the motion event index: a 16-byte header,
+// then records with a Fletcher-16 check, so a torn tail record is skipped by
+// readers. Each boot starts a new file.
+//
+// Airtime is estimated per frame from its length and PHY rate (preamble +
+// symbols, FCS included, no SIFS / ACK). Utilization is airtime over the
+// time the radio actually listened on the channel.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "dot11.h"
+#include "mac_set.h"
+#include "record_frame.h"
+
+#define SURVEY_MAGIC "SRVY"
+#define SURVEY_VERSION 1
+#define SURVEY_HEADER_SIZE RECORD_HEADER_SIZE
+#define SURVEY_CHANNELS 14         // Index = channel, 1..13 used
+#define SURVEY_RSSI_BUCKETS 8      // <-90, -90..-81, ..., -40..-31, >=-30 dBm
+#define SURVEY_MAX_TRANSMITTERS 512  // Per channel per interval, 3/4 usable
+#define SURVEY_CLOCK_SET 0x01      // time is wall clock, not seconds since boot
+#define SURVEY_TX_SATURATED 0x02   // More transmitters than the table holds
+
+struct SurveyHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint8_t reserved[8];
+};
+
+struct SurveyRecord {
+    uint32_t time;        // time() at the end of the interval
+    uint32_t uptimeS;
+    uint16_t intervalS;
+    uint8_t channel;
+    uint8_t flags;
+    uint32_t listenMs;    // Time the radio spent on this channel
+    uint32_t airtimeUs;   // Estimated airtime of the frames received
+    uint32_t frames;
+    uint32_t mgmt;
+    uint32_t ctrl;
+    uint32_t data;
+    uint32_t retries;
+    uint16_t transmitters;
+    int8_t rssiMean;
+    int8_t noiseFloor;    // Mean dBm
+    uint16_t rssi[SURVEY_RSSI_BUCKETS];  // Saturating
+    uint16_t beacons;     // Saturating
+    uint16_t check;
+};
+
+static_assert(sizeof(SurveyHeader) == SURVEY_HEADER_SIZE, "survey header layout");
+static_assert(sizeof(SurveyRecord) == 64, "survey record layout");
+
+// Accumulated between records; one per channel
+struct SurveyChannel {
+    uint32_t listenMs;
+    uint32_t airtimeUs;
+    uint32_t frames;
+    uint32_t types[3];
+    uint32_t retries;
+    uint32_t beacons;
+    int32_t rssiSum;
+    int32_t noiseSum;
+    uint32_t rssi[SURVEY_RSSI_BUCKETS];
+    MacSet transmitters;
+};
+
+static inline bool surveyValid(const SurveyRecord* r) {
+    return r->check == recordCheck(r, offsetof(SurveyRecord, check)) && r->channel > 0 &&
+           r->channel < SURVEY_CHANNELS;
+}
+
+static inline void surveyHeader(SurveyHeader* h) {
+    recordHeaderInit(h, SURVEY_MAGIC, SURVEY_VERSION, sizeof(SurveyRecord));
+}
+
+static inline bool surveyHeaderValid(const SurveyHeader* h) {
+    return recordHeaderValid(h, SURVEY_MAGIC, SURVEY_VERSION, sizeof(SurveyRecord));
+}
+
+// Legacy rate codes as the ESP32 reports them (wifi_phy_rate_t), in
+// 0.5 Mbps units; 0 = unused code
+static const uint8_t SURVEY_LEGACY_RATE[16] = {
+    2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18,
+};
+// HT data bits per symbol, MCS 0-7, one stream, 20 / 40 MHz
+static const uint16_t SURVEY_HT_DBPS[2][8] = {
+    { 26, 52, 78, 104, 156, 208, 234, 260 },
+    { 54, 108, 162, 216, 324, 432, 486, 540 },
+};
+
+// ht: HT frame (mcs, 40 MHz, short GI); otherwise rate is the legacy code
+static inline uint32_t surveyAirtimeUs(bool ht, uint8_t rate, uint8_t mcs, bool cwb40, bool sgi,
+                                       uint32_t len) {
+    uint32_t bits = 16 + 8 * len + 6;  // SERVICE + PSDU + tail
+    if (ht) {
+        uint32_t streams = mcs / 8 + 1;
+        uint32_t dbps = SURVEY_HT_DBPS[cwb40 ? 1 : 0][mcs % 8] * streams;
+        uint32_t symbols = (bits + dbps - 1) / dbps;
+        return 32 + 4 * streams + (sgi ? (symbols * 36 + 9) / 10 : symbols * 4);
+    }
+    uint8_t halfMbps = rate < 16 ? SURVEY_LEGACY_RATE[rate] : 0;
+    if (!halfMbps) halfMbps = 2;
+    if (rate < 8) {
+        // DSSS / CCK: long preamble for codes 0-3, short for 5-7
+        uint32_t preamble = rate < 4 ? 192 : 96;
+        return preamble + (16 * len + halfMbps - 1) / halfMbps;
+    }
+    uint32_t dbps = halfMbps * 2;  // 4 us symbols
+    return 20 + 4 * ((bits + dbps - 1) / dbps);
+}
+
+static inline uint8_t surveyRssiBucket(int rssi) {
+    int b = (rssi + 100) / 10;
+    if (rssi < -90) return 0;
+    return b >= SURVEY_RSSI_BUCKETS ? SURVEY_RSSI_BUCKETS - 1 : b;
+}
+
+static inline void surveyClear(SurveyChannel* c) {
+    MacSet tx = c->transmitters;
+    memset(c, 0, sizeof(*c));
+    c->transmitters = tx;
+    macSetClear(&c->transmitters);
+}
+
+static inline void surveyAdd(SurveyChannel* c, const uint8_t* f, uint32_t len, int rssi, int noise,
+                             uint32_t airtimeUs) {
+    c->frames++;
+    c->airtimeUs += airtimeUs;
+    c->rssiSum += rssi;
+    c->noiseSum += noise;
+    c->rssi[surveyRssiBucket(rssi)]++;
+    if (len < 2) return;
+    uint8_t type = dot11Type(f);
+    if (type < 3) c->types[type]++;
+    if (dot11Retry(f)) c->retries++;
+    if (type == DOT11_TYPE_MGMT && dot11Subtype(f) == DOT11_SUBTYPE_BEACON) c->beacons++;
+    const uint8_t* tx = dot11Transmitter(f, len);
+    if (tx) macSetInsert(&c->transmitters, tx);
+}
+
+static inline void surveyRecord(SurveyRecord* r, const SurveyChannel* c, uint8_t channel,
+                                uint32_t time, uint32_t uptimeS, uint16_t intervalS, uint8_t flags) {
+    memset(r, 0, sizeof(*r));
+    r->time = time;
+    r->uptimeS = uptimeS;
+    r->intervalS = intervalS;
+    r->channel = channel;
+    r->flags = flags | (c->transmitters.refused ? SURVEY_TX_SATURATED : 0);
+    r->listenMs = c->listenMs;
+    r->airtimeUs = c->airtimeUs;
+    r->frames = c->frames;
+    r->mgmt = c->types[DOT11_TYPE_MGMT];
+    r->ctrl = c->types[DOT11_TYPE_CTRL];
+    r->data = c->types[DOT11_TYPE_DATA];
+    r->retries = c->retries;
+    r->transmitters = recordSat16(c->transmitters.count);
+    r->rssiMean = c->frames ? c->rssiSum / (int32_t)c->frames : 0;
+    r->noiseFloor = c->frames ? c->noiseSum / (int32_t)c->frames : 0;
+    for (int i = 0; i < SURVEY_RSSI_BUCKETS; i++) r->rssi[i] = recordSat16(c->rssi[i]);
+    r->beacons = recordSat16(c->beacons);
+    r->check = recordCheck(r, offsetof(SurveyRecord, check));
+}
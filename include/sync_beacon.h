@@ -0,0 +1,100 @@
+#pragma once
+
+// Sync beacons for multi-node capture. The node with sync=1 in its
+// node.cfg sends one on every channel each SYNC_INTERVAL_MS, carrying its
+// own esp_timer microseconds at transmit. Every other node records the
+// beacon with its local timestamp, which gives tools/pcap-merge one
+// (reference time, local time) pair per reception to fit each node's
+// offset and drift against. The sync node records its own beacons too, so
+// its pairs are exact and it becomes the reference clock.
+//
+// Frame: beacon from SYNC_BEACON_MAC[0..4]:<node>, SSID SYNC_BEACON_SSID,
+// DS parameter set, then a vendor IE:
+//   OUI SYNC_BEACON_OUI, type 1, node, seq (LE32), tx_us (LE64)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "dot11.h"
+
+#define SYNC_INTERVAL_MS 10000
+#define SYNC_BEACON_SSID "espkit-sync"
+#define SYNC_BEACON_TYPE 1
+#define SYNC_BEACON_IE_LEN 17
+#define SYNC_BEACON_MAX 80  // Frame size including FCS
+
+static const uint8_t SYNC_BEACON_MAC[5] = { 0x02, 0xe5, 0x5c, 0x00, 0x00 };
+static const uint8_t SYNC_BEACON_OUI[3] = { 0x02, 0xe5, 0x5c };
+
+struct SyncBeacon {
+    uint8_t node;
+    uint32_t seq;
+    uint64_t txUs;  // Sync node clock at transmit
+};
+
+static inline uint32_t syncBeaconCrc(const uint8_t* p, size_t len) {
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+// Builds the frame with FCS into buf (SYNC_BEACON_MAX bytes) and returns its
+// length. Transmit len - DOT11_FCS_SIZE bytes; the radio appends the FCS.
+static inline size_t syncBeaconBuild(uint8_t* buf, uint8_t node, uint32_t seq, uint8_t channel,
+                                     uint64_t txUs) {
+    memset(buf, 0, DOT11_HEADER_SIZE + DOT11_BEACON_FIXED);
+    buf[0] = DOT11_SUBTYPE_BEACON << 4;
+    memset(buf + 4, 0xff, 6);
+    memcpy(buf + 10, SYNC_BEACON_MAC, 5);
+    buf[15] = node;
+    memcpy(buf + 16, buf + 10, 6);
+    buf[DOT11_HEADER_SIZE + 8] = 100;  // Beacon interval (TU)
+    buf[DOT11_HEADER_SIZE + 10] = 0x01;
+
+    size_t len = DOT11_HEADER_SIZE + DOT11_BEACON_FIXED;
+    buf[len++] = DOT11_IE_SSID;
+    buf[len++] = sizeof(SYNC_BEACON_SSID) - 1;
+    memcpy(buf + len, SYNC_BEACON_SSID, sizeof(SYNC_BEACON_SSID) - 1);
+    len += sizeof(SYNC_BEACON_SSID) - 1;
+    buf[len++] = DOT11_IE_DS_PARAMS;
+    buf[len++] = 1;
+    buf[len++] = channel;
+
+    buf[len++] = 221;
+    buf[len++] = SYNC_BEACON_IE_LEN;
+    memcpy(buf + len, SYNC_BEACON_OUI, 3);
+    len += 3;
+    buf[len++] = SYNC_BEACON_TYPE;
+    buf[len++] = node;
+    for (int i = 0; i < 4; i++) buf[len++] = seq >> (8 * i);
+    for (int i = 0; i < 8; i++) buf[len++] = txUs >> (8 * i);
+
+    uint32_t fcs = syncBeaconCrc(buf, len);
+    for (int i = 0; i < 4; i++) buf[len++] = fcs >> (8 * i);
+    return len;
+}
+
+static inline bool syncBeaconParse(const uint8_t* f, size_t len, SyncBeacon* out) {
+    if (len < DOT11_HEADER_SIZE || !dot11HasBeaconIes(f) ||
+        dot11Subtype(f) != DOT11_SUBTYPE_BEACON || memcmp(f + 10, SYNC_BEACON_MAC, 5) != 0) {
+        return false;
+    }
+    bool found = false;
+    dot11ForEachIe(f, len, [&](uint8_t tag, const uint8_t* d, uint8_t ieLen) {
+        if (tag != 221 || ieLen != SYNC_BEACON_IE_LEN || memcmp(d, SYNC_BEACON_OUI, 3) != 0 ||
+            d[3] != SYNC_BEACON_TYPE) {
+            return true;
+        }
+        out->node = d[4];
+        out->seq = 0;
+        out->txUs = 0;
+        for (int i = 0; i < 4; i++) out->seq |= (uint32_t)d[5 + i] << (8 * i);
+        for (int i = 0; i < 8; i++) out->txUs |= (uint64_t)d[9 + i] << (8 * i);
+        found = true;
+        return false;
+    });
+    return found;
+}
@@ -0,0 +1,143 @@
+#include <Arduino.h>
+#include "FS.h"
+#include "SD_MMC.h"
+#include "sd_card.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/soc.h"
+#include "power_watch.h"
+#include "esp_heap_caps.h"
+#include <algorithm>
+
+// SD write benchmark. Sequential writes of BENCH_BYTES per run across bus
+// width, block size, source buffer placement and flush cadence; prints
+// throughput and per-write latency percentiles, then idles.
+
+#define LED_PIN 33
+#define BENCH_FILE "/bench-sd.bin"
+#define BENCH_BYTES (2 * 1024 * 1024)
+#define BENCH_MAX_BLOCK 65536
+
+const uint8_t WIDTHS[] = { 1, 4 };
+const uint32_t BLOCK_SIZES[] = { 512, 4096, 16384, 32768, 65536 };
+
+struct Placement {
+    const char* name;
+    uint32_t caps;
+};
+
+const Placement PLACEMENTS[] = {
+    { "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA },
+    { "psram", MALLOC_CAP_SPIRAM },
+};
+
+// 0 = only on close, 1 = after every write, otherwise every N bytes
+const uint32_t FLUSH_EVERY[] = { 0, 1, 262144 };
+
+uint32_t* samples = nullptr;  // Per-write latency, us (PSRAM)
+
+struct Result {
+    float mbps;
+    uint32_t p50, p90, p99, max;
+    uint32_t closeUs;
+    bool ok;
+};
+
+uint32_t percentile(uint32_t n, uint32_t pct) {
+    uint32_t i = (uint64_t)n * pct / 100;
+    return samples[i < n ? i : n - 1];
+}
+
+Result runOnce(uint8_t* buf, uint32_t block, uint32_t flushEvery) {
+    Result r = {};
+    File f = SD_MMC.open(BENCH_FILE, FILE_WRITE);
+    if (!f) return r;
+
+    uint32_t writes = BENCH_BYTES / block;
+    uint32_t sinceFlush = 0;
+    uint32_t start = micros();
+    r.ok = true;
+    for (uint32_t i = 0; i < writes; i++) {
+        uint32_t t0 = micros();
+        if (f.write(buf, block) != block) r.ok = false;
+        sinceFlush += block;
+        if (flushEvery && sinceFlush >= flushEvery) {
+            f.flush();
+            sinceFlush = 0;
+        }
+        samples[i] = micros() - t0;
+    }
+    uint32_t t0 = micros();
+    f.close();
+    r.closeUs = micros() - t0;
+    uint32_t total = micros() - start;
+
+    std::sort(samples, samples + writes);
+    r.mbps = (float)BENCH_BYTES / total;  // bytes/us == MB/s
+    r.p50 = percentile(writes, 50);
+    r.p90 = percentile(writes, 90);
+    r.p99 = percentile(writes, 99);
+    r.max = samples[writes - 1];
+    return r;
+}
+
+void benchWidth(uint8_t width) {
+    SD_MMC.end();
+    if (!sdBeginWidth(width)) {
+        Serial.printf("[BENCH] %u-bit mount failed - skipped\n", width);
+        return;
+    }
+    Serial.printf("\n[BENCH] %u-bit @ %u kHz | card %llu MB\n",
+                  width, SD_FREQ_KHZ, SD_MMC.cardSize() / (1024 * 1024));
+    Serial.println("[BENCH] block  buffer    flush   |  MB/s |   p50 us |   p90 us |   p99 us |   max us | close us");
+
+    for (const Placement& p : PLACEMENTS) {
+        uint8_t* buf = (uint8_t*)heap_caps_malloc(BENCH_MAX_BLOCK, p.caps);
+        if (!buf) {
+            Serial.printf("[BENCH] %s buffer allocation failed - skipped\n", p.name);
+            continue;
+        }
+        for (uint32_t i = 0; i < BENCH_MAX_BLOCK; i++) buf[i] = i * 31;
+
+        for (uint32_t block : BLOCK_SIZES) {
+            for (uint32_t flushEvery : FLUSH_EVERY) {
+                char flush[12];
+                if (flushEvery == 0) snprintf(flush, sizeof(flush), "close");
+                else if (flushEvery == 1) snprintf(flush, sizeof(flush), "write");
+                else snprintf(flush, sizeof(flush), "%luK", flushEvery / 1024);
+
+                Result r = runOnce(buf, block, flushEvery);
+                Serial.printf("[BENCH] %5lu  %-8s  %-7s | %5.2f | %8lu | %8lu | %8lu | %8lu | %8lu%s\n",
+                              block, p.name, flush, r.mbps, r.p50, r.p90, r.p99, r.max, r.closeUs,
+                              r.ok ? "" : " WRITE ERRORS");
+            }
+        }
+        heap_caps_free(buf);
+    }
+    SD_MMC.remove(BENCH_FILE);
+}
+
+void setup() {
+    powerWatchInit();
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, LOW);
+
+    Serial.begin(115200);
+    Serial.println("\n[BENCH] SD write benchmark");
+    powerWatchBegin(nullptr);
+
+    samples = (uint32_t*)heap_caps_malloc(BENCH_BYTES / BLOCK_SIZES[0] * sizeof(uint32_t), MALLOC_CAP_SPIRAM);
+    if (!samples) {
+        Serial.println("[BENCH] Sample buffer allocation failed");
+        return;
+    }
+
+    uint32_t start = millis();
+    for (uint8_t width : WIDTHS) benchWidth(width);
+    Serial.printf("\n[BENCH] Done in %lu s\n", (millis() - start) / 1000);
+    digitalWrite(LED_PIN, HIGH);
+}
+
+void loop() {
+    powerWatchTick(millis());
+    delay(1000);
+}
@@ -3,6 +3,7 @@
 #include <esp_wifi.h>
 #include "soc/rtc_cntl_reg.h"
 #include "soc/soc.h"
+#include "power_watch.h"
 
 // EDIT THIS: Set specific target MAC to deauth, or leave empty to deauth ALL
 #define TARGET_MAC ""
@@ -58,7 +59,7 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
 }
 
 void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0); 
+    powerWatchInit();
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
     Serial.begin(115200);
@@ -74,9 +75,11 @@ void setup() {
     esp_wifi_set_promiscuous(true);
     esp_wifi_set_promiscuous_rx_cb(&sniffer_callback);
     Serial.println("DEAUTH RUNNING");
+    powerWatchBegin(nullptr);
 }
 
 void loop() {
+    powerWatchTick(millis());
     static uint8_t ch = 1;
     esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
     ch = (ch % 13) + 1;
@@ -0,0 +1,480 @@
+#include <time.h>
+#include <Arduino.h>
+#include "FS.h"
+#include "SD_MMC.h"
+#include "sd_card.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/soc.h"
+#include "esp_heap_caps.h"
+
+#if CONFIG_ESP32_CAMERA_ENABLED
+#include "esp_camera.h"
+#endif
+
+#include <WiFi.h>
+#include "esp_http_server.h"
+
+#include "motion_grid.h"
+#include "avi_writer.h"
+#include "jpeg_thumb.h"
+#include "boot_profile.h"
+#include "arena.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "power_watch.h"
+
+#define LED_PIN 33
+
+// Recording: continuous segments, or only while motion is seen
+#define DVR_RECORD_CONTINUOUS 0
+#define DVR_RECORD_MOTION 1
+#define DVR_RECORD_MODE DVR_RECORD_MOTION
+#define DVR_SEGMENT_MS 60000       // Continuous mode: new AVI every minute
+#define DVR_MOTION_HOLD 5000       // Motion mode: keep recording this long after motion
+
+// One capture task, shared framebuffers. Each frame is handed out by
+// reference count and returned to the driver when the last consumer is done:
+// 1 latest + 1 per viewer in flight + DVR_RECORD_QUEUE + 1 in aviAddFrame +
+// 2 for the driver to fill. httpd serves one handler at a time, so a second
+// viewer would wait anyway; the cap keeps the budget true if that changes.
+#define DVR_RECORD_QUEUE 2
+#define DVR_MAX_VIEWERS 1
+#define DVR_FB_COUNT (4 + DVR_MAX_VIEWERS + DVR_RECORD_QUEUE)
+#define DVR_FRAMESIZE FRAMESIZE_VGA
+#define AVI_WRITE_BUFFER CameraProfile::aviWriteBuffer
+#define STATUS_INTERVAL 5000
+#define FRAME_READY_BIT BIT0
+
+#define PWDN_GPIO_NUM     32
+#define RESET_GPIO_NUM    -1
+#define XCLK_GPIO_NUM      0
+#define SIOD_GPIO_NUM     26
+#define SIOC_GPIO_NUM     27
+#define Y9_GPIO_NUM       35
+#define Y8_GPIO_NUM       34
+#define Y7_GPIO_NUM       39
+#define Y6_GPIO_NUM       36
+#define Y5_GPIO_NUM       21
+#define Y4_GPIO_NUM       19
+#define Y3_GPIO_NUM       18
+#define Y2_GPIO_NUM        5
+#define VSYNC_GPIO_NUM    25
+#define HREF_GPIO_NUM     23
+#define PCLK_GPIO_NUM     22
+
+static const char PROGMEM INDEX_HTML[] = R"rawliteral(
+<!DOCTYPE html>
+<html>
+<head>
+<title>ESP-Kit DVR</title>
+<meta name="viewport" content="width=device-width, initial-scale=1">
+<style>
+body { margin: 0; background: #111; text-align: center; }
+img { max-width: 100%; max-height: 100vh; }
+</style>
+</head>
+<body>
+<img id="stream" src="/stream">
+</body>
+</html>
+)rawliteral";
+
+struct SharedFrame {
+    camera_fb_t* fb;
+    uint32_t seq;
+    int refs;
+};
+
+SharedFrame frames[DVR_FB_COUNT];
+SharedFrame* latest = nullptr;
+uint32_t frameSeq = 0;
+portMUX_TYPE frameLock = portMUX_INITIALIZER_UNLOCKED;
+EventGroupHandle_t frameEvents = nullptr;
+QueueHandle_t recordQueue = nullptr;  // SharedFrame*, nullptr closes the file
+
+String clipPrefix;
+Arena psramArena;     // Grid, AVI index, thumbnail
+Arena internalArena;  // AVI write buffer (DMA to SD)
+MotionGrid* grid = nullptr;
+JpegThumb thumb;
+AviWriter<File>* avi = nullptr;
+uint8_t* aviBuffer = nullptr;
+File clipFile;
+uint32_t clipStart = 0;
+uint32_t lastMotion = 0;
+bool recording = false;
+
+// Per-consumer frame counters for the status report
+volatile uint32_t captureFrames = 0;
+volatile uint32_t streamFrames = 0;
+volatile uint32_t recordFrames = 0;
+volatile uint32_t recordDropped = 0;
+volatile uint8_t viewers = 0;
+
+void initCamera() {
+    camera_config_t config;
+    config.ledc_channel = LEDC_CHANNEL_0;
+    config.ledc_timer = LEDC_TIMER_0;
+    config.pin_d0 = Y2_GPIO_NUM;
+    config.pin_d1 = Y3_GPIO_NUM;
+    config.pin_d2 = Y4_GPIO_NUM;
+    config.pin_d3 = Y5_GPIO_NUM;
+    config.pin_d4 = Y6_GPIO_NUM;
+    config.pin_d5 = Y7_GPIO_NUM;
+    config.pin_d6 = Y8_GPIO_NUM;
+    config.pin_d7 = Y9_GPIO_NUM;
+    config.pin_xclk = XCLK_GPIO_NUM;
+    config.pin_pclk = PCLK_GPIO_NUM;
+    config.pin_vsync = VSYNC_GPIO_NUM;
+    config.pin_href = HREF_GPIO_NUM;
+    config.pin_sccb_sda = SIOD_GPIO_NUM;
+    config.pin_sccb_scl = SIOC_GPIO_NUM;
+    config.pin_pwdn = PWDN_GPIO_NUM;
+    config.pin_reset = RESET_GPIO_NUM;
+    config.xclk_freq_hz = 20000000;
+    config.frame_size = DVR_FRAMESIZE;
+    config.pixel_format = PIXFORMAT_JPEG;
+    config.grab_mode = CAMERA_GRAB_LATEST;
+    config.fb_location = CAMERA_FB_IN_PSRAM;
+    config.jpeg_quality = 10;
+    config.fb_count = DVR_FB_COUNT;
+
+    esp_err_t err = esp_camera_init(&config);
+    if (err != ESP_OK) {
+        Serial.printf("[CAMERA] Init failed: %s\n", esp_err_to_name(err));
+        return;
+    }
+    Serial.println("[CAMERA] Init OK");
+}
+
+size_t arenaPlanSize() {
+    return ARENA_SIZE(sizeof(MotionGrid)) + ARENA_SIZE(sizeof(AviWriter<File>)) +
+           ARENA_SIZE(THUMB_MAX_W * THUMB_MAX_H);
+}
+
+bool initArena() {
+    if (!arenaInit(&psramArena, "dvr", arenaPlanSize(), ARENA_PSRAM) ||
+        !arenaInit(&internalArena, "dvr-avi", AVI_WRITE_BUFFER, ARENA_INTERNAL_DMA)) {
+        return false;
+    }
+    grid = (MotionGrid*)arenaAlloc(&psramArena, sizeof(MotionGrid));
+    avi = (AviWriter<File>*)arenaAlloc(&psramArena, sizeof(AviWriter<File>));
+    thumb.luma = (uint8_t*)arenaAlloc(&psramArena, THUMB_MAX_W * THUMB_MAX_H);
+    aviBuffer = (uint8_t*)arenaAlloc(&internalArena, AVI_WRITE_BUFFER);
+    motionGridInit(grid, MOTION_THRESHOLD);
+    return true;
+}
+
+void printPsramBudget() {
+    size_t fbSize = (size_t)resolution[DVR_FRAMESIZE].width * resolution[DVR_FRAMESIZE].height / 5;
+    size_t arena = arenaPlanSize();
+    Serial.printf("[DVR] PSRAM: %d x %u bytes framebuffers + %u bytes arena = %u bytes | Free: %u\n",
+                  DVR_FB_COUNT, fbSize, arena, DVR_FB_COUNT * fbSize + arena,
+                  heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
+
+// --- Shared frames -----------------------------------------------------------
+
+SharedFrame* acquireLatest() {
+    portENTER_CRITICAL(&frameLock);
+    SharedFrame* f = latest;
+    if (f) f->refs++;
+    portEXIT_CRITICAL(&frameLock);
+    return f;
+}
+
+void acquireFrame(SharedFrame* f) {
+    portENTER_CRITICAL(&frameLock);
+    f->refs++;
+    portEXIT_CRITICAL(&frameLock);
+}
+
+void releaseFrame(SharedFrame* f) {
+    if (!f) return;
+    portENTER_CRITICAL(&frameLock);
+    bool last = --f->refs == 0;
+    portEXIT_CRITICAL(&frameLock);
+    if (last) esp_camera_fb_return(f->fb);
+}
+
+SharedFrame* freeSlot() {
+    SharedFrame* slot = nullptr;
+    portENTER_CRITICAL(&frameLock);
+    for (int i = 0; i < DVR_FB_COUNT && !slot; i++) {
+        if (frames[i].refs == 0) slot = &frames[i];
+    }
+    portEXIT_CRITICAL(&frameLock);
+    return slot;
+}
+
+// Makes fb the latest frame; the previous latest loses the capture reference
+void publishFrame(SharedFrame* slot, camera_fb_t* fb) {
+    slot->fb = fb;
+    slot->seq = ++frameSeq;
+    slot->refs = 1;
+
+    portENTER_CRITICAL(&frameLock);
+    SharedFrame* old = latest;
+    latest = slot;
+    portEXIT_CRITICAL(&frameLock);
+
+    releaseFrame(old);
+    // Wakes every waiting viewer; clearing right away makes it a pulse
+    xEventGroupSetBits(frameEvents, FRAME_READY_BIT);
+    xEventGroupClearBits(frameEvents, FRAME_READY_BIT);
+}
+
+// --- Recorder ----------------------------------------------------------------
+
+void openClip(const camera_fb_t* fb) {
+    char filename[64];
+    snprintf(filename, sizeof(filename), "%s-%lu.avi", clipPrefix.c_str(), millis());
+    clipFile = SD_MMC.open(filename, FILE_WRITE);
+    if (!clipFile) {
+        Serial.println("[SD] Failed to open file");
+        return;
+    }
+    aviOpen(avi, &clipFile, aviBuffer, AVI_WRITE_BUFFER, fb->width, fb->height);
+    clipStart = millis();
+    Serial.printf("[REC] %s\n", filename);
+}
+
+void closeClip() {
+    if (!clipFile) return;
+    bool ok = aviClose(avi);
+    size_t size = clipFile.size();
+    clipFile.close();
+    Serial.printf("[REC] Closed%s (%u frames, %u bytes)\n", ok ? "" : " with errors", avi->frames, size);
+}
+
+// Runs on core 0 next to WiFi; the capture task owns core 1
+void recorderTask(void* arg) {
+    SharedFrame* f;
+    while (true) {
+        if (xQueueReceive(recordQueue, &f, portMAX_DELAY) != pdTRUE) continue;
+        if (!f) {
+            closeClip();
+            continue;
+        }
+
+        bool segmentDone = DVR_RECORD_MODE == DVR_RECORD_CONTINUOUS && millis() - clipStart > DVR_SEGMENT_MS;
+        if (clipFile && (segmentDone || aviFull(avi->frames))) closeClip();
+        if (!clipFile) openClip(f->fb);
+
+        if (clipFile) {
+            uint32_t ms = f->fb->timestamp.tv_sec * 1000 + f->fb->timestamp.tv_usec / 1000;
+            aviAddFrame(avi, f->fb->buf, f->fb->len, ms);
+            recordFrames++;
+        }
+        releaseFrame(f);
+    }
+}
+
+bool motionSeen(const camera_fb_t* fb) {
+    if (!grid || !jpegThumbDecode(&thumb, fb->buf, fb->len)) return false;
+    return motionGridFeed(grid, thumb.luma, thumb.w, thumb.h) >= MOTION_MIN_BLOCKS;
+}
+
+void feedRecorder(SharedFrame* f, uint32_t now) {
+    bool want = true;
+    if (DVR_RECORD_MODE == DVR_RECORD_MOTION) {
+        if (motionSeen(f->fb)) lastMotion = now;
+        want = lastMotion && now - lastMotion < DVR_MOTION_HOLD;
+    }
+
+    if (!want) {
+        // The recorder closes the clip only on this marker. With the queue
+        // full, stay recording and retry on the next frame rather than stall
+        if (recording) {
+            SharedFrame* end = nullptr;
+            if (xQueueSend(recordQueue, &end, 0) != pdTRUE) return;
+            recording = false;
+            Serial.println("[REC] Motion ended");
+        }
+        return;
+    }
+
+    if (!recording) {
+        recording = true;
+        Serial.println("[REC] Recording");
+    }
+    acquireFrame(f);
+    if (xQueueSend(recordQueue, &f, 0) != pdTRUE) {
+        // Recorder is behind - skip the frame, never stall capture or viewers
+        releaseFrame(f);
+        recordDropped++;
+    }
+}
+
+// Single producer for every consumer
+void captureTask(void* arg) {
+    while (true) {
+        camera_fb_t* fb = esp_camera_fb_get();
+        if (!fb) {
+            Serial.println("[CAMERA] Frame failed");
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        SharedFrame* slot = powerAdmit() ? freeSlot() : nullptr;
+        if (!slot) {
+            esp_camera_fb_return(fb);
+            continue;
+        }
+        publishFrame(slot, fb);
+        captureFrames++;
+
+        if (clipPrefix.length()) feedRecorder(slot, millis());
+        digitalWrite(LED_PIN, recording ? LOW : HIGH);
+    }
+}
+
+// --- Web ---------------------------------------------------------------------
+
+esp_err_t index_handler(httpd_req_t *req) {
+    httpd_resp_send(req, INDEX_HTML, strlen(INDEX_HTML));
+    return ESP_OK;
+}
+
+esp_err_t stream_handler(httpd_req_t *req) {
+    if (viewers >= DVR_MAX_VIEWERS) {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "Stream busy");
+    }
+    httpd_resp_set_type(req, "multipart/x-mixed-replace; boundary=frame");
+    viewers++;
+
+    uint32_t lastSeq = 0;
+    esp_err_t res = ESP_OK;
+    while (res == ESP_OK) {
+        xEventGroupWaitBits(frameEvents, FRAME_READY_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(1000));
+        SharedFrame* f = acquireLatest();
+        if (!f) continue;
+        if (f->seq == lastSeq) {
+            releaseFrame(f);
+            continue;
+        }
+        lastSeq = f->seq;
+
+        char buf[128];
+        snprintf(buf, sizeof(buf), "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", f->fb->len);
+        res = httpd_resp_send_chunk(req, buf, strlen(buf));
+        if (res == ESP_OK) res = httpd_resp_send_chunk(req, (const char*)f->fb->buf, f->fb->len);
+        if (res == ESP_OK) res = httpd_resp_send_chunk(req, "\r\n", 2);
+        releaseFrame(f);
+        if (res == ESP_OK) streamFrames++;
+    }
+
+    viewers--;
+    return res;
+}
+
+void startWebServer() {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = 80;
+
+    httpd_uri_t index_uri = {
+        .uri = "/",
+        .method = HTTP_GET,
+        .handler = index_handler,
+        .user_ctx = NULL
+    };
+
+    httpd_uri_t stream_uri = {
+        .uri = "/stream",
+        .method = HTTP_GET,
+        .handler = stream_handler,
+        .user_ctx = NULL
+    };
+
+    httpd_handle_t server = NULL;
+    if (httpd_start(&server, &config) == ESP_OK) {
+        httpd_register_uri_handler(server, &index_uri);
+        httpd_register_uri_handler(server, &stream_uri);
+        Serial.println("[SERVER] Started");
+    }
+}
+
+void initStorage() {
+    if (!sdBegin()) {
+        Serial.println("[SD] Init FAILED - streaming only");
+    } else {
+        Serial.println("[SD] Init OK");
+        time_t now = time(nullptr);
+        struct tm* ti = localtime(&now);
+        char prefix[64];
+        snprintf(prefix, sizeof(prefix), "/dvr/%04d%02d%02d-%02d%02d%02d",
+                 ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday,
+                 ti->tm_hour, ti->tm_min, ti->tm_sec);
+        SD_MMC.mkdir("/dvr");
+        if (initArena()) clipPrefix = String(prefix);
+    }
+}
+
+void status(uint32_t now) {
+    static uint32_t lastCapture = 0, lastStream = 0, lastRecord = 0;
+    uint32_t interval = STATUS_INTERVAL / 1000;
+
+    uint32_t capture = captureFrames, stream = streamFrames, record = recordFrames;
+    Serial.printf("[STATUS] Capture: %lu fps | Stream: %lu fps (%u viewer) | Record: %lu fps (dropped %lu) | PSRAM free: %u\n",
+                  (capture - lastCapture) / interval, (stream - lastStream) / interval, viewers,
+                  (record - lastRecord) / interval, recordDropped,
+                  heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+    lastCapture = capture;
+    lastStream = stream;
+    lastRecord = record;
+    heapWatchTick(now);
+    powerWatchTick(now);
+}
+
+void setup() {
+    powerWatchInit();
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, HIGH);
+
+    Serial.begin(115200);
+    Serial.println("\n[DVR] Starting...");
+
+    // SD mount overlaps camera and WiFi init
+    BootTask sd;
+    bootStart(&sd, "sd", initStorage, 0);
+
+    int p = bootPhaseBegin("camera");
+    initCamera();
+    bootPhaseEnd(p);
+
+    p = bootPhaseBegin("wifi");
+    WiFi.softAP("ESP-Kit", "12345678");
+    bootPhaseEnd(p);
+
+    bootWait(&sd);
+    printPsramBudget();
+
+    frameEvents = xEventGroupCreate();
+    recordQueue = xQueueCreate(DVR_RECORD_QUEUE, sizeof(SharedFrame*));
+    xTaskCreatePinnedToCore(recorderTask, "recorder", 4096, nullptr, 1, nullptr, 0);
+    xTaskCreatePinnedToCore(captureTask, "capture", 4096, nullptr, 2, nullptr, 1);
+
+    Serial.println("[WiFi] AP: ESP-Kit");
+    Serial.println("[WiFi] Pass: 12345678");
+    Serial.print("[WiFi] IP: ");
+    Serial.println(WiFi.softAPIP());
+
+    p = bootPhaseBegin("server");
+    startWebServer();
+    bootPhaseEnd(p);
+
+    bootProfilePrint();
+    arenaReport();
+    heapWatchBegin();
+    powerWatchBegin("frames");
+    schedEvery("status", STATUS_INTERVAL, status);
+    Serial.printf("[DVR] Running - recording %s\n",
+                  DVR_RECORD_MODE == DVR_RECORD_MOTION ? "on motion" : "continuously");
+}
+
+// Capture, streaming and recording run in their own tasks; the loop task
+// only wakes for the status line
+void loop() {
+    schedRun();
+}
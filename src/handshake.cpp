@@ -4,13 +4,23 @@
 #include <esp_wifi.h>
 #include "FS.h"
 #include "SD_MMC.h"
+#include "sd_card.h"
 #include "soc/rtc_cntl_reg.h"
 #include "soc/soc.h"
-#include <set>
+
+#include "binlog.h"
+#include "arena.h"
+#include "mac_set.h"
+#include "power_watch.h"
 
 #define LED_PIN 33
 
-std::set<String> seenHandshakes;
+// BSSID + message number of every EAPOL frame already saved: 3/4 usable,
+// 768 BSSIDs x 4 messages in PSRAM, 192 in internal RAM without it
+#define HANDSHAKE_MAX_KEYS 4096
+#define HANDSHAKE_MAX_KEYS_INTERNAL 1024
+Arena tableArena;
+MacSet seenHandshakes;
 File pcapFile;
 bool pcapInitialized = false;
 uint8_t targetBSSID[6];
@@ -94,7 +104,16 @@ void captureHandshake(uint8_t* payload, uint16_t len, uint8_t msgNum, uint8_t* b
     pcapFile.write(payload, len);
     pcapFile.close();
 
-    Serial.printf("[HANDSHAKE] Msg%d captured\n", msgNum);
+    LOGI("[HANDSHAKE] Msg%d captured\n", msgNum);
+}
+
+// Each (BSSID, message) is saved once. Past a full or missing table it is
+// saved every time - duplicates in the pcap beat lost handshakes
+bool newHandshake(const uint8_t* bssid, uint8_t msgNum) {
+    if (!seenHandshakes.slots) return true;
+    uint32_t refused = seenHandshakes.refused;
+    if (macSetInsert(&seenHandshakes, bssid, msgNum)) return true;
+    return seenHandshakes.refused != refused;
 }
 
 void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
@@ -109,14 +128,12 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
             targetChannel = payload[10 + 6];
             targetSet = true;
 
-            char macStr[18];
-            sprintf(macStr, "%02X:%02X:%02X:%02X:%02X:%02X",
-                    targetBSSID[0], targetBSSID[1], targetBSSID[2],
-                    targetBSSID[3], targetBSSID[4], targetBSSID[5]);
             int ssid_len = payload[37];
             char ssid[33] = {0};
             if (ssid_len > 0 && ssid_len <= 32) memcpy(ssid, &payload[38], ssid_len);
-            Serial.printf("[TARGET] %s | %s | CH: %d\n", ssid, macStr, targetChannel);
+            LOGI("[TARGET] %s | %02X:%02X:%02X:%02X:%02X:%02X | CH: %d\n", logText(ssid),
+                 targetBSSID[0], targetBSSID[1], targetBSSID[2],
+                 targetBSSID[3], targetBSSID[4], targetBSSID[5], targetChannel);
 
             char pcapName[32];
             sprintf(pcapName, "/handshake/%02X%02X%02X%02X%02X%02X.pcap",
@@ -140,7 +157,7 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
                 pcapFile.write((uint8_t*)&network, 4);
                 pcapFile.close();
             }
-            Serial.println("[*] Sending deauth to force reconnection...");
+            LOGI("[*] Sending deauth to force reconnection...\n");
         }
 
         // Capture deauth frames
@@ -148,10 +165,8 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
             uint8_t* bssid = &payload[4];
             uint8_t* client = &payload[10];
             if (memcmp(bssid, targetBSSID, 6) == 0 && client[0] != 0xFF) {
-                char clientStr[18];
-                sprintf(clientStr, "%02X:%02X:%02X:%02X:%02X:%02X",
-                        client[0], client[1], client[2], client[3], client[4], client[5]);
-                Serial.printf("[CLIENT] %s\n", clientStr);
+                LOGI("[CLIENT] %02X:%02X:%02X:%02X:%02X:%02X\n",
+                     client[0], client[1], client[2], client[3], client[4], client[5]);
             }
         }
 
@@ -166,18 +181,13 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
             else if (keyInfo & 0x0008) msgNum = 4;
 
             if (msgNum > 0) {
-                char key[18];
-                sprintf(key, "%02X%02X%02X%02X%02X%02X-Msg%d",
-                        bssid[0], bssid[1], bssid[2],
-                        bssid[3], bssid[4], bssid[5], msgNum);
-
-                if (seenHandshakes.find(String(key)) == seenHandshakes.end()) {
-                    seenHandshakes.insert(String(key));
+                if (newHandshake(bssid, msgNum)) {
                     digitalWrite(LED_PIN, LOW);
                     captureHandshake(payload, len, msgNum, bssid);
                     digitalWrite(LED_PIN, HIGH);
 
-                    Serial.printf("[HANDSHAKE] %s\n", key);
+                    LOGI("[HANDSHAKE] %02X%02X%02X%02X%02X%02X-Msg%d\n",
+                         bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], msgNum);
                 }
             }
         }
@@ -201,7 +211,7 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
 }
 
 void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+    powerWatchInit();
     pinMode(LED_PIN, OUTPUT);
     // Blink LED to show code is running
     for(int i=0; i<5; i++) {
@@ -212,15 +222,26 @@ void setup() {
     }
     digitalWrite(LED_PIN, HIGH);
     Serial.begin(115200);
+    binlogBegin();
     delay(100);
     Serial.println("Starting...");
     Serial.flush();
 
+    uint32_t keys = HANDSHAKE_MAX_KEYS;
+    bool table = arenaInit(&tableArena, "handshakes", macSetBytes(keys), ARENA_PSRAM);
+    if (!table) {
+        keys = HANDSHAKE_MAX_KEYS_INTERNAL;
+        table = arenaInit(&tableArena, "handshakes", macSetBytes(keys), ARENA_INTERNAL);
+    }
+    if (table) macSetInit(&seenHandshakes, arenaAlloc(&tableArena, macSetBytes(keys)), keys);
+    else Serial.println("[HANDSHAKE] No dedup table - every EAPOL frame is saved");
+    arenaReport();
+
     Serial.println("Init SD...");
     Serial.flush();
     
     // Don't block on SD - just continue without it
-    if (!SD_MMC.begin("/sdcard", true)) {
+    if (!sdBegin()) {
         Serial.println("SD: FAILED (continuing without)");
     } else {
         Serial.println("SD: OK");
@@ -256,17 +277,20 @@ void setup() {
     Serial.flush();
     Serial.println("Waiting for target network...");
     Serial.flush();
+    powerWatchBegin(nullptr);
 }
 
 void loop() {
     uint32_t now = millis();
+    powerWatchTick(now);
     static uint32_t stageStartTime = 0;
     static uint8_t ch = 1;
     static uint32_t debugTime = 0;
     
     // Debug: print every 10 seconds
     if (now - debugTime > 10000) {
-        Serial.printf("Running: stage=%d, ch=%d\n", stage, ch);
+        Serial.printf("Running: stage=%d, ch=%d | Handshake keys: %lu, past full table: %lu\n", stage,
+                      ch, seenHandshakes.count, seenHandshakes.refused);
         Serial.flush();
         debugTime = now;
     }
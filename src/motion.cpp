@@ -2,17 +2,65 @@
 #include <Arduino.h>
 #include "FS.h"
 #include "SD_MMC.h"
+#include "sd_card.h"
 #include "soc/rtc_cntl_reg.h"
 #include "soc/soc.h"
 
+#include "esp_heap_caps.h"
+
 #if CONFIG_ESP32_CAMERA_ENABLED
 #include "esp_camera.h"
 #endif
 
+#include "motion_grid.h"
+#include "avi_writer.h"
+#include "jpeg_thumb.h"
+#include "motion_index.h"
+#include "module.h"
+#include "boot_profile.h"
+#include "binlog.h"
+#include "probe.h"
+#include "arena.h"
+#include "profile.h"
+#include "power_watch.h"
+
 #define LED_PIN 33
-String photoPrefix;
-#define MOTION_THRESHOLD 20
+MODULE_BEGIN(motion)
+String sessionPrefix;  // Boot timestamp, names this session's clips
 #define MOTION_COOLDOWN 5000
+#define MOTION_MASK_FILE "/motion/mask.txt"
+#define MOTION_INDEX_FILE "/motion/events.idx"
+#define MOTION_SHARD_HOURLY 1     // /motion/YYYYMMDD/HH/ - 0 for /motion/YYYYMMDD/
+#define CLOCK_VALID_AFTER 1577836800  // 2020-01-01 - earlier means the clock was never set
+
+// Pre-roll: the last PREROLL_FRAMES camera framebuffers are held instead of
+// returned, so the ring is the driver's own PSRAM buffers (zero-copy). The
+// driver keeps two extra buffers to fill while we hold the rest.
+#define PREROLL_FRAMES CameraProfile::prerollFrames
+#define POSTROLL_FRAMES 32
+#define CAMERA_FB_COUNT (PREROLL_FRAMES + 2)
+#define PSRAM_RESERVE 262144      // Left free for WiFi/SD/other PSRAM users
+#define WRITER_STACK 4096
+#define AVI_WRITE_BUFFER CameraProfile::aviWriteBuffer  // Internal RAM, batches frame appends
+#define STATUS_INTERVAL 5000
+
+// Boot waits for auto exposure instead of a fixed delay: the background is
+// primed once SETTLE_FRAMES consecutive thumbnails agree on mean luma within
+// SETTLE_TOLERANCE, or after SETTLE_MAX_MS regardless.
+#define SETTLE_FRAMES 3
+#define SETTLE_TOLERANCE 2
+#define SETTLE_MAX_MS 3000
+
+// Dual mode: detect at DETECT_FRAMESIZE and switch the sensor up to
+// CAPTURE_FRAMESIZE only for the post-trigger burst. Framebuffers are sized
+// for CAPTURE_FRAMESIZE at init so both fit. Set to 0 to stay at capture size.
+#define DUAL_MODE 1
+#define DETECT_FRAMESIZE CameraProfile::detectFrameSize
+#define CAPTURE_FRAMESIZE CameraProfile::captureFrameSize
+
+// At 1/8 a QVGA detect frame is 40x30, 2-3 px per block of the 16x12 grid;
+// at 1/4 it is 80x60, 5x5 px. Detect sizes up to SVGA fit the thumbnail
+#define DETECT_THUMB_SCALE (DUAL_MODE ? THUMB_SCALE_4 : THUMB_SCALE_8)
 
 #define PWDN_GPIO_NUM     32
 #define RESET_GPIO_NUM    -1
@@ -32,10 +80,80 @@ String photoPrefix;
 #define PCLK_GPIO_NUM     22
 
 uint32_t lastCaptureTime = 0;
-uint8_t* baselineFrame = nullptr;
-bool baselineSet = false;
 camera_fb_t* fb = nullptr;
 
+// Motion state lives in arenas planned at boot - nothing per frame. The AVI
+// write buffer is DMA'd to SD so it is internal; the rest goes to PSRAM.
+Arena psramArena;
+Arena internalArena;
+MotionGrid* grid = nullptr;
+JpegThumb thumb;
+
+// A frame handed to the writer task, which returns it to the driver when saved.
+// fb == nullptr marks the end of the clip.
+struct ClipFrame {
+    camera_fb_t* fb;
+    uint32_t event;  // millis() of the trigger, names the clip
+    uint16_t seq;
+};
+
+// Owned by the writer task
+AviWriter<File>* avi = nullptr;  // In the PSRAM arena (holds the idx1 table)
+uint8_t* aviBuffer = nullptr;
+File clipFile;
+uint32_t clipFileEvent = 0;
+uint8_t clipPart = 0;
+MotionEventRecord clipRecord;    // Index record of the clip being written
+char clipPath[80];
+char currentShard[16];
+
+QueueHandle_t eventQueue = nullptr;  // MotionEventRecord, loop -> writer
+SemaphoreHandle_t writerDone = nullptr;  // Given by the writer when it exits
+volatile bool writerStop = false;
+
+// Writer metrics - written by the writer task, sampled by the status report
+volatile uint32_t writeCount = 0;
+volatile uint32_t writeTotalUs = 0;  // Wraps; only deltas are used
+volatile uint32_t writeMaxUs = 0;
+volatile uint32_t closeMaxUs = 0;
+
+camera_fb_t* preroll[PREROLL_FRAMES];
+uint8_t prerollHead = 0;  // Oldest frame
+uint8_t prerollCount = 0;
+
+QueueHandle_t writerQueue = nullptr;
+uint32_t queuedFrames = 0;             // Only written by loop()
+volatile uint32_t returnedFrames = 0;  // Only written by the writer task
+uint32_t droppedFrames = 0;
+uint32_t clipEvent = 0;
+uint16_t clipSeq = 0;
+uint16_t postrollLeft = 0;
+uint32_t frameCount = 0;
+uint32_t queuePeak = 0;
+
+// Sensor reconfiguration - frames of the old size are dropped until it settles
+uint16_t awaitingWidth = 0;
+uint32_t switchStart = 0;
+uint32_t switchCallMs = 0;
+uint16_t staleFrames = 0;
+uint32_t triggerTime = 0;
+
+struct FrameSizeInfo {
+    const char* name;
+    uint16_t width;
+    uint16_t height;
+};
+
+const FrameSizeInfo FRAME_SIZES[] = {
+    { "QVGA", 320, 240 },
+    { "VGA", 640, 480 },
+    { "SVGA", 800, 600 },
+    { "XGA", 1024, 768 },
+    { "HD", 1280, 720 },
+    { "SXGA", 1280, 1024 },
+    { "UXGA", 1600, 1200 },
+};
+
 void initCamera() {
     camera_config_t config;
     config.ledc_channel = LEDC_CHANNEL_0;
@@ -57,12 +175,12 @@ void initCamera() {
     config.pin_pwdn = PWDN_GPIO_NUM;
     config.pin_reset = RESET_GPIO_NUM;
     config.xclk_freq_hz = 20000000;
-    config.frame_size = FRAMESIZE_SVGA;
+    config.frame_size = CAPTURE_FRAMESIZE;
     config.pixel_format = PIXFORMAT_JPEG;
     config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
     config.fb_location = CAMERA_FB_IN_PSRAM;
-    config.jpeg_quality = 12;
-    config.fb_count = 2;
+    config.jpeg_quality = CameraProfile::captureQuality;
+    config.fb_count = CAMERA_FB_COUNT;
 
     esp_err_t err = esp_camera_init(&config);
     if (err != ESP_OK) {
@@ -72,104 +190,485 @@ void initCamera() {
     Serial.println("[CAMERA] Init OK");
 }
 
-bool detectMotion(uint8_t* current, size_t len) {
-    if (!baselineSet || !baselineFrame || len < 1000) return false;
+bool initMotionArena() {
+    size_t psramSize = ARENA_SIZE(sizeof(MotionGrid)) + ARENA_SIZE(sizeof(AviWriter<File>)) +
+                       ARENA_SIZE(THUMB_MAX_W * THUMB_MAX_H);
+    if (!arenaInit(&psramArena, "motion", psramSize, ARENA_PSRAM) ||
+        !arenaInit(&internalArena, "motion-avi", AVI_WRITE_BUFFER, ARENA_INTERNAL_DMA)) {
+        return false;
+    }
+    grid = (MotionGrid*)arenaAlloc(&psramArena, sizeof(MotionGrid));
+    avi = (AviWriter<File>*)arenaAlloc(&psramArena, sizeof(AviWriter<File>));
+    thumb.luma = (uint8_t*)arenaAlloc(&psramArena, THUMB_MAX_W * THUMB_MAX_H);
+    aviBuffer = (uint8_t*)arenaAlloc(&internalArena, AVI_WRITE_BUFFER);
+    motionGridInit(grid, MOTION_THRESHOLD);
+    return true;
+}
+
+void loadMotionMask() {
+    File f = SD_MMC.open(MOTION_MASK_FILE, FILE_READ);
+    if (!f) return;
 
-    size_t skip = 200;
-    size_t cmpLen = len > skip ? min((size_t)10000, len - skip) : 0;
-    if (cmpLen < 100) return false;
+    char text[(MOTION_GRID_COLS + 2) * MOTION_GRID_ROWS];
+    size_t len = f.read((uint8_t*)text, sizeof(text));
+    f.close();
 
-    uint32_t diff = 0;
-    for (size_t i = 0; i < cmpLen; i++) {
-        int d = baselineFrame[skip + i] - current[skip + i];
-        if (d < 0) d = -d;
-        diff += d;
+    uint16_t set = motionGridLoadMask(grid, text, len, MOTION_THRESHOLD);
+    Serial.printf("[MOTION] Mask loaded: %u blocks\n", set);
+}
+
+bool detectMotion(camera_fb_t* fb) {
+    PROBE("detectMotion");
+    if (!grid) return false;
+    {
+        PROBE("jpegThumbDecode");
+        if (!jpegThumbDecode(&thumb, fb->buf, fb->len, DETECT_THUMB_SCALE)) return false;
+    }
+
+    bool primed = grid->primed;
+    uint16_t fired;
+    {
+        PROBE("motionGridFeed");
+        fired = motionGridFeed(grid, thumb.luma, thumb.w, thumb.h);
+    }
+    if (!primed) return false;
+
+    if (fired > 0) {
+        LOGD("[MOTION] Blocks: %u | Max diff: %u\n", fired, grid->maxDelta);
+    }
+
+    return fired >= MOTION_MIN_BLOCKS;
+}
+
+void printFiredBlocks() {
+    char row[MOTION_GRID_COLS + 1];
+    row[MOTION_GRID_COLS] = 0;
+    for (uint16_t r = 0; r < MOTION_GRID_ROWS; r++) {
+        for (uint16_t c = 0; c < MOTION_GRID_COLS; c++) {
+            uint16_t b = r * MOTION_GRID_COLS + c;
+            if (grid->threshold[b] == MOTION_BLOCK_MASKED) row[c] = '.';
+            else row[c] = motionGridBlockFired(grid, b) ? '#' : '-';
+        }
+        LOGI("[BLOCKS] %s\n", logText(row));
     }
+}
 
-    uint32_t avgDiff = diff / cmpLen;
-    Serial.printf("[MOTION] Avg diff: %d\n", avgDiff);
+// Shard directory from the event's clock, e.g. "20240131/17"
+void shardName(const MotionEventRecord& rec, char* out, size_t len) {
+    time_t t = rec.time;
+    struct tm* ti = localtime(&t);
+#if MOTION_SHARD_HOURLY
+    snprintf(out, len, "%04d%02d%02d/%02d", ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday, ti->tm_hour);
+#else
+    snprintf(out, len, "%04d%02d%02d", ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday);
+#endif
+}
 
-    return avgDiff > MOTION_THRESHOLD;
+void ensureShard(const char* shard) {
+    if (strcmp(shard, currentShard) == 0) return;
+
+    char dir[32];
+    snprintf(dir, sizeof(dir), "/motion/%.8s", shard);
+    SD_MMC.mkdir(dir);
+    snprintf(dir, sizeof(dir), "/motion/%s", shard);
+    SD_MMC.mkdir(dir);
+    strlcpy(currentShard, shard, sizeof(currentShard));
 }
 
-void savePhoto(camera_fb_t* fb) {
-    char filename[64];
-    uint32_t ts = millis();
-    snprintf(filename, sizeof(filename), "%s-%lu.jpg", photoPrefix.c_str(), ts);
+void appendIndex(const MotionEventRecord& rec) {
+    File f = SD_MMC.open(MOTION_INDEX_FILE, FILE_APPEND);
+    if (!f) {
+        Serial.println("[INDEX] Failed to open index");
+        return;
+    }
 
-    File file = SD_MMC.open(filename, FILE_WRITE);
-    if (!file) {
+    if (f.size() == 0) {
+        MotionIndexHeader header;
+        motionIndexHeader(&header);
+        f.write((uint8_t*)&header, sizeof(header));
+    } else {
+        // A torn record from a power cut - pad it out so we stay aligned
+        static const uint8_t zeros[sizeof(MotionEventRecord)] = { 0 };
+        size_t pad = motionIndexPad(f.size());
+        if (pad) f.write(zeros, pad);
+    }
+    f.write((const uint8_t*)&rec, sizeof(rec));
+    f.close();
+}
+
+void printRecentEvents(int count) {
+    File f = SD_MMC.open(MOTION_INDEX_FILE, FILE_READ);
+    if (!f) return;
+
+    MotionIndexHeader header;
+    if (f.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || !motionIndexHeaderValid(&header)) {
+        Serial.println("[INDEX] Unknown index format");
+        f.close();
+        return;
+    }
+
+    size_t records = (f.size() - sizeof(header)) / sizeof(MotionEventRecord);
+    Serial.printf("[INDEX] %u events\n", records);
+    size_t first = records > (size_t)count ? records - count : 0;
+    for (size_t i = first; i < records; i++) {
+        MotionEventRecord rec;
+        f.seek(sizeof(header) + i * sizeof(rec));
+        if (f.read((uint8_t*)&rec, sizeof(rec)) != sizeof(rec) || !motionIndexValid(&rec)) continue;
+        Serial.printf("[INDEX] %lu | %s | Blocks: %u | Max diff: %u\n",
+                      rec.time, rec.file, rec.firedCount, rec.maxDelta);
+    }
+    f.close();
+}
+
+void openClip(const camera_fb_t* frame) {
+    char shard[16];
+    shardName(clipRecord, shard, sizeof(shard));
+    ensureShard(shard);
+
+    char name[48];
+    if (clipPart == 0) {
+        snprintf(name, sizeof(name), "%s/%s-%lu.avi", shard, sessionPrefix.c_str(), clipFileEvent);
+    } else {
+        snprintf(name, sizeof(name), "%s/%s-%lu-%u.avi", shard, sessionPrefix.c_str(), clipFileEvent, clipPart);
+    }
+    snprintf(clipPath, sizeof(clipPath), "/motion/%s", name);
+
+    clipFile = SD_MMC.open(clipPath, FILE_WRITE);
+    if (!clipFile) {
         Serial.println("[SD] Failed to open file");
         return;
     }
+    aviOpen(avi, &clipFile, aviBuffer, AVI_WRITE_BUFFER, frame->width, frame->height);
 
-    file.write(fb->buf, fb->len);
-    file.close();
+    if (clipPart == 0) {
+        strlcpy(clipRecord.file, name, sizeof(clipRecord.file));
+        motionIndexSeal(&clipRecord);
+        appendIndex(clipRecord);
+    }
+}
 
-    Serial.printf("[CAPTURE] Saved %s (%d bytes)\n", filename, fb->len);
-    digitalWrite(LED_PIN, LOW);
-    delay(100);
-    digitalWrite(LED_PIN, HIGH);
+void closeClip() {
+    if (!clipFile) return;
+
+    uint32_t start = micros();
+    bool ok = aviClose(avi);
+    size_t size = clipFile.size();
+    clipFile.close();
+    uint32_t us = micros() - start;
+    if (us > closeMaxUs) closeMaxUs = us;
+
+    Serial.printf("[CAPTURE] Saved %s%s (%u frames, %u bytes)\n",
+                  clipPath, ok ? "" : " with errors", avi->frames, size);
 }
 
-void cleanupBaseline() {
-    if (baselineFrame) {
-        free(baselineFrame);
-        baselineFrame = nullptr;
-        baselineSet = false;
-        Serial.println("[BASELINE] Cleaned up");
+void saveClipFrame(const ClipFrame& frame) {
+    PROBE("saveClipFrame");
+    if (frame.event != clipFileEvent || !clipFile) {
+        closeClip();
+        clipFileEvent = frame.event;
+        clipPart = 0;
+        // Skip records of events whose frames never reached us
+        bool found = false;
+        while (!found && xQueueReceive(eventQueue, &clipRecord, 0) == pdTRUE) {
+            found = clipRecord.uptimeMs == frame.event;
+        }
+        if (!found) {
+            memset(&clipRecord, 0, sizeof(clipRecord));
+            clipRecord.time = time(nullptr);
+            clipRecord.uptimeMs = frame.event;
+        }
+        openClip(frame.fb);
+    } else if (aviFull(avi->frames) || frame.fb->width != avi->width || frame.fb->height != avi->height) {
+        // Index is full or the sensor changed size - continue in a new part
+        closeClip();
+        clipPart++;
+        openClip(frame.fb);
     }
+    if (!clipFile) return;
+
+    uint32_t ms = frame.fb->timestamp.tv_sec * 1000 + frame.fb->timestamp.tv_usec / 1000;
+    uint32_t start = micros();
+    aviAddFrame(avi, frame.fb->buf, frame.fb->len, ms);
+    uint32_t us = micros() - start;
+
+    writeTotalUs += us;
+    writeCount++;
+    if (us > writeMaxUs) writeMaxUs = us;
 }
 
-void setBaseline(camera_fb_t* fb) {
-    cleanupBaseline();  // Clean up old baseline first
-    baselineFrame = (uint8_t*)malloc(fb->len);
-    if (baselineFrame) {
-        memcpy(baselineFrame, fb->buf, fb->len);
-        baselineSet = true;
-        Serial.println("[BASELINE] Set");
-    } else {
-        Serial.println("[BASELINE] Memory allocation failed");
+// Runs on core 0 so SD writes never stall the capture loop
+void writerTask(void* arg) {
+    ClipFrame frame;
+    while (true) {
+        if (xQueueReceive(writerQueue, &frame, portMAX_DELAY) != pdTRUE) continue;
+        if (!frame.fb) {
+            closeClip();
+            if (writerStop) break;
+            continue;
+        }
+        saveClipFrame(frame);
+        esp_camera_fb_return(frame.fb);
+        returnedFrames++;
     }
+    xSemaphoreGive(writerDone);
+    vTaskDelete(nullptr);
 }
 
-void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
-    pinMode(LED_PIN, OUTPUT);
-    digitalWrite(LED_PIN, HIGH);
+uint32_t framesHeld() {
+    return prerollCount + (queuedFrames - returnedFrames);
+}
 
-    Serial.begin(115200);
-    delay(1000);
-    Serial.println("\n[MOTION] Starting...");
-    Serial.flush();
+void dropOldestPreroll() {
+    esp_camera_fb_return(preroll[prerollHead]);
+    prerollHead = (prerollHead + 1) % PREROLL_FRAMES;
+    prerollCount--;
+}
 
-    if (!SD_MMC.begin("/sdcard", true)) {
+// Hand a frame to the writer. Frames from the ring are already counted as held.
+// The power governor thins the clip here; detection still sees every frame.
+bool queueClipFrame(camera_fb_t* frame, bool fromRing) {
+    if (!powerAdmit()) return false;
+    ClipFrame item = { frame, clipEvent, clipSeq };
+    if (xQueueSend(writerQueue, &item, 0) != pdTRUE) return false;
+    queuedFrames++;
+    uint32_t depth = uxQueueMessagesWaiting(writerQueue);
+    if (depth > queuePeak) queuePeak = depth;
+    clipSeq++;
+    if (fromRing) prerollCount--;
+    return true;
+}
+
+void pushPreroll(camera_fb_t* frame) {
+    while (prerollCount > 0 && framesHeld() >= PREROLL_FRAMES) {
+        dropOldestPreroll();
+    }
+    if (framesHeld() >= PREROLL_FRAMES) {
+        // Writer still owns every spare buffer - keep the driver fed
+        esp_camera_fb_return(frame);
+        return;
+    }
+    preroll[(prerollHead + prerollCount) % PREROLL_FRAMES] = frame;
+    prerollCount++;
+}
+
+void startClip(uint32_t now) {
+    clipEvent = now;
+    clipSeq = 0;
+
+    MotionEventRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.time = time(nullptr);
+    rec.uptimeMs = now;
+    rec.flags = rec.time > CLOCK_VALID_AFTER ? MOTION_EVENT_CLOCK_SET : 0;
+    motionIndexFromGrid(&rec, grid);
+    xQueueSend(eventQueue, &rec, 0);
+
+    while (prerollCount > 0) {
+        camera_fb_t* oldest = preroll[prerollHead];
+        prerollHead = (prerollHead + 1) % PREROLL_FRAMES;
+        if (!queueClipFrame(oldest, true)) {
+            esp_camera_fb_return(oldest);
+            prerollCount--;
+            droppedFrames++;
+        }
+    }
+}
+
+void setFrameSize(framesize_t size) {
+    sensor_t* s = esp_camera_sensor_get();
+    if (!s) return;
+
+    switchStart = millis();
+    s->set_framesize(s, size);
+    switchCallMs = millis() - switchStart;
+    awaitingWidth = resolution[size].width;
+    staleFrames = 0;
+}
+
+// Returns false (and hands the frame back) while the sensor still delivers
+// frames of the previous size after a switch.
+bool frameSizeSettled(camera_fb_t* frame) {
+    if (!awaitingWidth) return true;
+    if (frame->width != awaitingWidth) {
+        esp_camera_fb_return(frame);
+        staleFrames++;
+        return false;
+    }
+
+    uint32_t now = millis();
+    LOGI("[MODE] %ux%u in %lu ms (set_framesize %lu ms, %u stale) | Trigger to frame: %lu ms\n",
+         frame->width, frame->height, now - switchStart, switchCallMs, staleFrames,
+         postrollLeft > 0 ? now - triggerTime : 0);
+    awaitingWidth = 0;
+    return true;
+}
+
+void endClip() {
+    ClipFrame end = { nullptr, clipEvent, clipSeq };
+    xQueueSend(writerQueue, &end, 0);
+    LOGI("[CLIP] %lu done | Frames: %u | Dropped: %lu\n", clipEvent, clipSeq, droppedFrames);
+#if DUAL_MODE
+    setFrameSize(DETECT_FRAMESIZE);
+#endif
+}
+
+void pushPostroll(camera_fb_t* frame) {
+    if (framesHeld() >= PREROLL_FRAMES || !queueClipFrame(frame, false)) {
+        // Writer is behind - drop rather than pause capture
+        esp_camera_fb_return(frame);
+        droppedFrames++;
+    }
+}
+
+void printPrerollBudget() {
+    size_t fbSize = (size_t)resolution[CAPTURE_FRAMESIZE].width * resolution[CAPTURE_FRAMESIZE].height / 5;
+    size_t ringBytes = fbSize * CAMERA_FB_COUNT;
+    size_t freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t budget = freePsram + ringBytes > PSRAM_RESERVE ? freePsram + ringBytes - PSRAM_RESERVE : 0;
+
+    Serial.printf("[PREROLL] Ring: %d x %u bytes = %u bytes PSRAM (%d pre, %d post)\n",
+                  CAMERA_FB_COUNT, fbSize, ringBytes, PREROLL_FRAMES, POSTROLL_FRAMES);
+    for (size_t i = 0; i < sizeof(FRAME_SIZES) / sizeof(FRAME_SIZES[0]); i++) {
+        // Driver sizes JPEG framebuffers at width * height / 5
+        size_t size = (size_t)FRAME_SIZES[i].width * FRAME_SIZES[i].height / 5;
+        size_t depth = budget / size;
+        depth = depth > 2 ? depth - 2 : 0;
+        Serial.printf("[PREROLL] Max depth %s: %u frames\n", FRAME_SIZES[i].name, depth);
+    }
+}
+
+// LED on while a clip is being captured or still draining to SD
+void updateLed() {
+    bool busy = postrollLeft > 0 || queuedFrames != returnedFrames;
+    digitalWrite(LED_PIN, busy ? LOW : HIGH);
+}
+
+void printStatus(uint32_t now) {
+    static uint32_t lastStatus = 0;
+    static uint32_t lastFrames = 0;
+    static uint32_t lastWrites = 0;
+    static uint32_t lastWriteUs = 0;
+    if (now - lastStatus < STATUS_INTERVAL) return;
+
+    uint32_t writes = writeCount;
+    uint32_t writeUs = writeTotalUs;
+    uint32_t n = writes - lastWrites;
+    uint32_t avgUs = n ? (writeUs - lastWriteUs) / n : 0;
+    uint32_t fps10 = (frameCount - lastFrames) * 10000 / (now - lastStatus);
+
+    Serial.printf("[STATUS] FPS: %lu.%lu | Queue: %u (peak %lu) | Write: avg %lu us, max %lu us | Close max: %lu us | Dropped: %lu\n",
+                  fps10 / 10, fps10 % 10, uxQueueMessagesWaiting(writerQueue), queuePeak,
+                  avgUs, writeMaxUs, closeMaxUs, droppedFrames);
+
+    lastStatus = now;
+    lastFrames = frameCount;
+    lastWrites = writes;
+    lastWriteUs = writeUs;
+    queuePeak = 0;
+    writeMaxUs = 0;
+    closeMaxUs = 0;
+}
+
+uint8_t thumbMean() {
+    uint32_t sum = 0;
+    uint32_t n = (uint32_t)thumb.w * thumb.h;
+    for (uint32_t i = 0; i < n; i++) sum += thumb.luma[i];
+    return n ? sum / n : 0;
+}
+
+// Runs frames until exposure settles, then primes the background on the last one
+void primeBackground() {
+    uint32_t start = millis();
+    int prevMean = -1;
+    uint8_t steady = 0;
+    uint16_t frames = 0;
+    bool primed = false;
+
+    while (grid) {
+        fb = esp_camera_fb_get();
+        if (!fb) break;
+        if (!frameSizeSettled(fb)) continue;
+        bool ok = jpegThumbDecode(&thumb, fb->buf, fb->len, DETECT_THUMB_SCALE);
+        esp_camera_fb_return(fb);
+        if (!ok) continue;
+        frames++;
+
+        int mean = thumbMean();
+        steady = prevMean >= 0 && abs(mean - prevMean) <= SETTLE_TOLERANCE ? steady + 1 : 0;
+        prevMean = mean;
+        if (steady >= SETTLE_FRAMES || millis() - start > SETTLE_MAX_MS) {
+            grid->primed = false;
+            motionGridFeed(grid, thumb.luma, thumb.w, thumb.h);
+            primed = true;
+            break;
+        }
+    }
+    Serial.printf("[MOTION] Exposure %s after %u frames, %lu ms (mean luma %d)\n",
+                  primed && steady >= SETTLE_FRAMES ? "settled" : "not settled",
+                  frames, millis() - start, prevMean);
+}
+
+void initStorage() {
+    if (!sdBegin()) {
         Serial.println("[SD] Init FAILED");
     } else {
         Serial.println("[SD] Init OK");
         time_t now = time(nullptr);
         struct tm* ti = localtime(&now);
         char prefix[64];
-        snprintf(prefix, sizeof(prefix), "/motion/%04d%02d%02d-%02d%02d%02d",
+        snprintf(prefix, sizeof(prefix), "%04d%02d%02d-%02d%02d%02d",
                  ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday,
                  ti->tm_hour, ti->tm_min, ti->tm_sec);
-        photoPrefix = String(prefix);
+        sessionPrefix = String(prefix);
         SD_MMC.mkdir("/motion");
+        printRecentEvents(5);
     }
+}
+
+void setup() {
+    powerWatchInit();
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, HIGH);
 
+    Serial.begin(115200);
+    binlogBegin();
+    Serial.println("\n[MOTION] Starting...");
+
+    // SD mount overlaps camera init - separate peripherals and pins
+    BootTask sd;
+    bootStart(&sd, "sd", initStorage, 0);
+
+    int p = bootPhaseBegin("camera");
     initCamera();
+#if DUAL_MODE
+    setFrameSize(DETECT_FRAMESIZE);
+#endif
+    bootPhaseEnd(p);
 
-    delay(3000);
-    fb = esp_camera_fb_get();
-    if (fb) {
-        setBaseline(fb);
-        esp_camera_fb_return(fb);
-    }
+    p = bootPhaseBegin("arena");
+    bool arena = initMotionArena();
+    bootPhaseEnd(p);
+    printPrerollBudget();
+
+    bootWait(&sd);
+    if (arena) loadMotionMask();
+
+    // One spare slot for the end-of-clip marker
+    writerQueue = xQueueCreate(CAMERA_FB_COUNT + 1, sizeof(ClipFrame));
+    eventQueue = xQueueCreate(4, sizeof(MotionEventRecord));
+    writerDone = xSemaphoreCreateBinary();
+    writerStop = false;
+    xTaskCreatePinnedToCore(writerTask, "writer", WRITER_STACK, nullptr, 1, nullptr, 0);
+
+    p = bootPhaseBegin("settle");
+    primeBackground();
+    bootPhaseEnd(p);
 
+    bootProfilePrint();
+    arenaReport();
+    heapWatchBegin();
+    powerWatchBegin("frames");
     Serial.println("[MOTION] Running - waiting for motion...");
-    
-    // Clear baseline at end of setup to free memory from initial frame
-    cleanupBaseline();
 }
 
 void loop() {
@@ -181,16 +680,76 @@ void loop() {
         delay(1000);
         return;
     }
+    if (!frameSizeSettled(fb)) return;
 
-    if (now > 5000 && detectMotion(fb->buf, fb->len)) {
-        if (now - lastCaptureTime > MOTION_COOLDOWN) {
-            Serial.println("[MOTION] DETECTED!");
-            savePhoto(fb);
+    // In dual mode the post-roll is the high-res burst - no detection there
+    bool detecting = !(DUAL_MODE && postrollLeft > 0);
+
+    if (detecting && detectMotion(fb)) {
+        if (postrollLeft > 0) {
+            postrollLeft = POSTROLL_FRAMES + 1;  // Motion continues - extend clip
+            lastCaptureTime = now;
+        } else if (!lastCaptureTime || now - lastCaptureTime > MOTION_COOLDOWN) {
+            LOGI("[MOTION] DETECTED!\n");
+            printFiredBlocks();
+            startClip(now);
+            postrollLeft = POSTROLL_FRAMES + 1;  // Trigger frame plus post-roll
             lastCaptureTime = now;
-            setBaseline(fb);
+            triggerTime = now;
+#if DUAL_MODE
+            setFrameSize(CAPTURE_FRAMESIZE);
+#endif
         }
     }
 
-    esp_camera_fb_return(fb);
-    delay(500);
+    if (postrollLeft > 0) {
+        pushPostroll(fb);
+        if (--postrollLeft == 0) endClip();
+    } else {
+        pushPreroll(fb);
+    }
+
+    frameCount++;
+    updateLed();
+    printStatus(now);
+    PROBE_REPORT(now);
+    heapWatchTick(now);
+    powerWatchTick(now);
 }
+
+// Finishes the open clip, stops the writer and frees the camera and arena,
+// for mode switching
+void teardown() {
+    while (prerollCount > 0) dropOldestPreroll();
+    if (writerQueue) {
+        // Frames ahead of the marker are written first; the writer exits on it
+        writerStop = true;
+        ClipFrame end = { nullptr, clipEvent, clipSeq };
+        xQueueSend(writerQueue, &end, portMAX_DELAY);
+        xSemaphoreTake(writerDone, portMAX_DELAY);
+        vQueueDelete(writerQueue);
+        vQueueDelete(eventQueue);
+        vSemaphoreDelete(writerDone);
+        writerQueue = nullptr;
+        eventQueue = nullptr;
+        writerDone = nullptr;
+    }
+    esp_camera_deinit();
+
+    arenaFree(&psramArena);
+    arenaFree(&internalArena);
+    aviBuffer = nullptr;
+    grid = nullptr;
+    avi = nullptr;
+
+    prerollHead = 0;
+    queuedFrames = 0;
+    returnedFrames = 0;
+    postrollLeft = 0;
+    awaitingWidth = 0;
+    clipFileEvent = 0;
+    lastCaptureTime = 0;
+    digitalWrite(LED_PIN, HIGH);
+}
+
+MODULE_END
@@ -0,0 +1,177 @@
+#include <Arduino.h>
+#include "FS.h"
+#include "SD_MMC.h"
+#include "sd_card.h"
+#include "soc/rtc_cntl_reg.h"
+#include "soc/soc.h"
+#include "esp_heap_caps.h"
+#include "power_watch.h"
+
+// One image with the passive modules (sniffer, motion, stream). The mode is
+// read from MODE_CONFIG_FILE at boot and can be switched at runtime from the
+// serial console ("mode <name>") or MODE_BUTTON_PIN without reflashing. A
+// switch tears the running module down and starts the next one in place.
+
+#define LED_PIN 33
+#define MODE_CONFIG_FILE "/espkit.cfg"  // "mode=<name>"
+#define MODE_BUTTON_PIN -1              // e.g. 13 (free with SD in 1-bit mode), -1 disables
+#define DEFAULT_MODE 0                  // Index into MODULES
+
+namespace sniffer { void setup(); void loop(); void teardown(); }
+namespace motion { void setup(); void loop(); void teardown(); }
+namespace stream { void setup(); void loop(); void teardown(); }
+
+struct Module {
+    const char* name;
+    void (*setup)();
+    void (*loop)();
+    void (*teardown)();
+};
+
+const Module MODULES[] = {
+    { "sniffer", sniffer::setup, sniffer::loop, sniffer::teardown },
+    { "motion", motion::setup, motion::loop, motion::teardown },
+    { "stream", stream::setup, stream::loop, stream::teardown },
+};
+const int MODULE_COUNT = sizeof(MODULES) / sizeof(MODULES[0]);
+
+int current = -1;
+bool sdReady = false;
+char command[32];
+uint8_t commandLen = 0;
+
+int findModule(const char* name) {
+    for (int i = 0; i < MODULE_COUNT; i++) {
+        if (strcmp(MODULES[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int readConfiguredMode() {
+    if (!sdReady) return DEFAULT_MODE;
+    File f = SD_MMC.open(MODE_CONFIG_FILE, FILE_READ);
+    if (!f) return DEFAULT_MODE;
+
+    int mode = DEFAULT_MODE;
+    while (f.available()) {
+        String line = f.readStringUntil('\n');
+        line.trim();
+        if (!line.startsWith("mode=")) continue;
+        int found = findModule(line.substring(5).c_str());
+        if (found >= 0) mode = found;
+        else Serial.printf("[MODE] Unknown mode in %s: %s\n", MODE_CONFIG_FILE, line.c_str());
+    }
+    f.close();
+    return mode;
+}
+
+// Remembered so the next boot comes up in the same mode
+void saveMode(int mode) {
+    if (!sdReady) return;
+    File f = SD_MMC.open(MODE_CONFIG_FILE, FILE_WRITE);
+    if (!f) return;
+    f.printf("mode=%s\n", MODULES[mode].name);
+    f.close();
+}
+
+void printHeap(const char* label) {
+    Serial.printf("[MODE] %s | Heap: %u | PSRAM: %u\n", label,
+                  heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                  heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+}
+
+void switchModule(int mode) {
+    if (mode == current) return;
+
+    uint32_t start = millis();
+    if (current >= 0) {
+        Serial.printf("[MODE] Stopping %s\n", MODULES[current].name);
+        MODULES[current].teardown();
+        printHeap("Stopped");
+    }
+    uint32_t stopped = millis();
+    size_t heapBefore = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+    current = mode;
+    MODULES[current].setup();
+    uint32_t started = millis();
+
+    Serial.printf("[MODE] %s running | Teardown: %lu ms | Setup: %lu ms | Total: %lu ms | Heap used: %d\n",
+                  MODULES[current].name, stopped - start, started - stopped, started - start,
+                  (int)(heapBefore - heap_caps_get_free_size(MALLOC_CAP_INTERNAL)));
+}
+
+void handleCommand(const char* line) {
+    if (strcmp(line, "mode") == 0) {
+        Serial.printf("[MODE] Current: %s | Available:", MODULES[current].name);
+        for (int i = 0; i < MODULE_COUNT; i++) Serial.printf(" %s", MODULES[i].name);
+        Serial.println();
+        return;
+    }
+    if (strncmp(line, "mode ", 5) != 0) return;
+
+    int mode = findModule(line + 5);
+    if (mode < 0) {
+        Serial.printf("[MODE] Unknown mode: %s\n", line + 5);
+        return;
+    }
+    switchModule(mode);
+    saveMode(mode);
+}
+
+void pollSerial() {
+    while (Serial.available()) {
+        char c = Serial.read();
+        if (c == '\r' || c == '\n') {
+            command[commandLen] = 0;
+            if (commandLen) handleCommand(command);
+            commandLen = 0;
+        } else if (commandLen < sizeof(command) - 1) {
+            command[commandLen++] = c;
+        }
+    }
+}
+
+// A press cycles to the next module
+void pollButton() {
+#if MODE_BUTTON_PIN >= 0
+    static bool wasPressed = false;
+    static uint32_t pressedAt = 0;
+    bool pressed = digitalRead(MODE_BUTTON_PIN) == LOW;
+    if (pressed && !wasPressed) pressedAt = millis();
+    if (!pressed && wasPressed && millis() - pressedAt > 50) {
+        int mode = (current + 1) % MODULE_COUNT;
+        switchModule(mode);
+        saveMode(mode);
+    }
+    wasPressed = pressed;
+#endif
+}
+
+void setup() {
+    uint32_t bootStart = millis();
+    powerWatchInit();
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, HIGH);
+#if MODE_BUTTON_PIN >= 0
+    pinMode(MODE_BUTTON_PIN, INPUT_PULLUP);
+#endif
+
+    Serial.begin(115200);
+    Serial.println("\n[MULTI] Starting...");
+
+    // Mounted once here; the modules' own sdBegin() sees it mounted
+    sdReady = sdBegin();
+    Serial.println(sdReady ? "[SD] Init OK" : "[SD] Init FAILED");
+
+    int mode = readConfiguredMode();
+    printHeap("Boot");
+    switchModule(mode);
+    Serial.printf("[MULTI] Boot: %lu ms (%lu ms since reset)\n", millis() - bootStart, millis());
+}
+
+void loop() {
+    pollSerial();
+    pollButton();
+    MODULES[current].loop();
+}
@@ -4,8 +4,10 @@
 #include <esp_wifi.h>
 #include "FS.h"
 #include "SD_MMC.h"
+#include "sd_card.h"
 #include "soc/rtc_cntl_reg.h"
 #include "soc/soc.h"
+#include "power_watch.h"
 #include <set>
 
 #define LED_PIN 33
@@ -193,7 +195,7 @@ void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
 }
 
 void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+    powerWatchInit();
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
     Serial.begin(115200);
@@ -205,7 +207,7 @@ void setup() {
              ti->tm_hour, ti->tm_min, ti->tm_sec);
     pmkidFilename = String(fname);
 
-    if (SD_MMC.begin("/sdcard", true)) {
+    if (sdBegin()) {
         Serial.println("SD: OK");
         SD_MMC.mkdir("/pmkid");
     } else {
@@ -217,9 +219,11 @@ void setup() {
     esp_wifi_set_promiscuous_rx_cb(&sniffer_callback);
     Serial.println("PMKID CAPTURE RUNNING");
     Serial.println("Waiting for association request...");
+    powerWatchBegin(nullptr);
 }
 
 void loop() {
+    powerWatchTick(millis());
     if (!targetSet) {
         static uint8_t ch = 1;
         esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
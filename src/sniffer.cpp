@@ -1,43 +1,201 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <esp_wifi.h>
+#include <esp_timer.h>
 #include "FS.h"
 #include "SD_MMC.h"
+#include "sd_card.h"
 #include "soc/rtc_cntl_reg.h"
 #include "soc/soc.h"
 #include <time.h>
-#include <set>
+#include <unistd.h>
 
-#define PCAP_BUFFER_SIZE 1024  // Buffer size in bytes
-#define PCAP_MAX_PACKETS 10    // Max packets per buffer
+#include "module.h"
+#include "boot_profile.h"
+#include "pcap_scan.h"
+#include "binlog.h"
+#include "probe.h"
+#include "arena.h"
+#include "mac_set.h"
+#include "mac_map.h"
+#include "beacon_print.h"
+#include "sync_beacon.h"
+#include "survey.h"
+#include "client_stats.h"
+#include "scheduler.h"
+#include "burst_ring.h"
+#include "profile.h"
+#include "power_watch.h"
+
+#define PCAP_BUFFER_SIZE CaptureProfile::pcapBuffer  // SD write size; larger frames span writes
+
+// Durability: buffers are written as they fill, but the FAT sync (size and
+// cluster chain) only happens once PCAP_SYNC_BYTES are written or
+// PCAP_SYNC_MS have passed. A power cut loses at most that much; the torn
+// tail it leaves is cut off by the recovery pass at the next boot.
+#define PCAP_SYNC_BYTES 65536
+#define PCAP_SYNC_MS 5000
+#define PCAP_LAST_FILE "/sniffer/last"  // Name of the capture in progress
+#define PCAP_SCAN_CHUNK 4096
+#define SNIFFER_MAX_APS CaptureProfile::maxAps  // Distinct BSSIDs reported as [NEW]
+#define BEACON_CHANGE_LOG_MAX 8  // Per AP; a flapping AP is counted, not logged
+
+// Multi-node capture: each board reads its node id, channel subset and hop
+// dwell from NODE_CONFIG_FILE, e.g. "node=2", "channels=6-9", "dwell=250",
+// and one board adds "sync=1" to send sync beacons (sync_beacon.h) that
+// tools/pcap-merge aligns the captures on. Without the file the sniffer
+// hops all 13 channels as a single node.
+#define NODE_CONFIG_FILE "/sniffer/node.cfg"
+#define CHANNELS_ALL 0x3ffe  // Bits 1..13
+#define HOP_DWELL_MS 1000
+#define RX_LAG_WINDOW_MS 10000  // Receive-time offset re-estimated this often
+#define RX_LAG_MAX_US 100000    // Callback later than this: the timestamp is not trusted
+
+// Survey mode ("survey=<seconds>" in NODE_CONFIG_FILE): per-channel airtime,
+// frame mix, RSSI, retries and transmitters are accumulated in the callback
+// and written as survey.h records every interval - no pcap
+#define SURVEY_MIN_S 10
+#define SURVEY_MAX_S 3600  // Keeps airtimeUs within 32 bits
+#define CLOCK_VALID_AFTER 1577836800  // 2020-01-01 - earlier means the clock was never set
+
+// Client activity ("clients=<seconds>" in NODE_CONFIG_FILE): per-BSSID
+// traffic and station counts from data and probe frames, written as
+// client_stats.h records every interval. Runs next to pcap or survey.
+#define CLIENTS_MIN_S 10
+#define CLIENTS_MAX_S 3600  // Record byte counts saturate past 4 GB per interval
+#define CLIENT_MAX_BSS CaptureProfile::clientBss
+#define CLIENT_MAX_STATIONS CaptureProfile::clientStations
+static_assert(CLIENT_MAX_BSS <= 0x8000, "BSS slots are MacSet tags");
+
+// Burst ring (burst_ring.h): the callback stores frames in PSRAM and a drain
+// task writes them to SD, so a spike the card can't keep up with is
+// absorbed and written out afterwards. "burst=newest|oldest|headers" in
+// NODE_CONFIG_FILE picks what goes once the ring is full. Without PSRAM the
+// callback writes to the SD buffer directly, as before.
+#define BURST_RING_BYTES CaptureProfile::burstRing
+#define BURST_REPORT_BYTES 65536  // Fill that counts as a burst worth logging
+#define DRAIN_STACK 4096
+#define DRAIN_DEFER_MS 100  // Wait per SD write the power governor holds back
+
+// The drain copies whole records into the SD buffer; bufferPos is 16-bit
+static_assert(PCAP_BUFFER_SIZE >= BURST_ENTRY(2560) && PCAP_BUFFER_SIZE <= 65535,
+              "profile pcapBuffer out of range");
 
 #define LED_PIN 33
+#define STATUS_MS 5000
+#define HOUSEKEEPING_MS 1000  // Pcap / survey flush checks, probe and heap reports
+#define SCHED_REPORT_MS 300000
 
-// Status LED patterns
-void ledBlink(int times, int duration) {
-    for (int i = 0; i < times; i++) {
-        digitalWrite(LED_PIN, LOW);
-        delay(duration);
-        digitalWrite(LED_PIN, HIGH);
-        delay(duration);
-    }
-}
+MODULE_BEGIN(sniffer)
+
+int ledEvent = -1;  // One-shot, see startEvents()
 
 void ledSolid(bool on) {
     digitalWrite(LED_PIN, on ? LOW : HIGH);
 }
 
-std::set<String> seenMACs;
+// Status LED patterns, stepped by ledEvent instead of blocking the loop
+uint8_t ledToggles = 0;
+uint16_t ledStepMs = 0;
+bool ledOn = false;
+
+void ledStep(uint32_t now) {
+    if (!ledToggles) return;
+    ledOn = !ledOn;
+    ledSolid(ledOn);
+    if (--ledToggles) schedAfter(ledEvent, ledStepMs);
+}
+
+void ledBlink(int times, int duration) {
+    ledOn = false;
+    ledToggles = times * 2;
+    ledStepMs = duration;
+    ledStep(millis());
+}
+
+// Memory plan: the pcap buffer is written to SD, so it stays in internal
+// DMA-capable RAM; the BSSID table goes to PSRAM
+Arena internalArena;
+Arena psramArena;
+// AP inventory: each BSSID's beacon fingerprint (beacon_print.h), so a
+// reconfigured AP is reported as a [CHANGE]
+struct ApInfo {
+    BeaconPrint print;
+    uint16_t changes;
+};
+MacMap<ApInfo> seenAPs;
+uint32_t beaconChanges = 0;
 File pcapFile;
 String pcapFilename;
 bool pcapInitialized = false;
 uint32_t packetCount = 0;
 uint8_t currentChannel = 1;
 
+struct NodeConfig {
+    int id;             // -1: standalone
+    uint16_t channels;  // Bit n = channel n
+    uint32_t dwellMs;
+    bool syncSource;
+    uint32_t surveyS;   // Survey interval, 0: capture pcap
+    uint8_t burstPolicy;
+    uint32_t clientsS;  // Client activity interval, 0: off
+};
+NodeConfig node = { -1, CHANNELS_ALL, HOP_DWELL_MS, false, 0, BURST_DROP_NEWEST, 0 };
+uint32_t syncSeq = 0;
+
+// Receive times (rxTimeUs), WiFi task only
+bool rxLagSet = false;
+uint32_t rxLag = 0;           // esp_timer - rx_ctrl.timestamp, mod 2^32, at the least delay
+int32_t rxLagWindowMin = INT32_MAX;
+uint64_t rxLagWindowAt = 0;
+
+// Survey: the callback adds to the active bank; loop() flips banks under
+// surveyMux at each interval and writes out the other one
+Arena surveyArena;  // Transmitter sets, PSRAM
+SurveyChannel surveyBanks[2][SURVEY_CHANNELS];
+volatile uint8_t surveyActive = 0;
+volatile bool surveyRunning = false;
+portMUX_TYPE surveyMux = portMUX_INITIALIZER_UNLOCKED;
+File surveyFile;
+String surveyFilename;
+uint32_t lastSurvey = 0;
+uint32_t surveyRecords = 0;
+
+// Client activity: banked like the survey, under clientMux
+Arena clientArena;  // BSS and station tables, PSRAM
+ClientBank clientBanks[2];
+volatile uint8_t clientActive = 0;
+volatile bool clientsRunning = false;
+portMUX_TYPE clientMux = portMUX_INITIALIZER_UNLOCKED;
+File clientFile;
+uint32_t lastClients = 0;
+uint32_t clientRecords = 0;
+
 // SD card buffering
-uint8_t pcapBuffer[PCAP_BUFFER_SIZE];
+uint8_t* pcapBuffer = nullptr;  // PCAP_BUFFER_SIZE, in internalArena
 uint16_t bufferPos = 0;  // Current position in buffer
 
+// Burst ring: filled by the callback (and sync bursts), emptied by
+// drainTask; every ring call is under burstMux
+Arena burstArena;
+BurstRing ring;
+portMUX_TYPE burstMux = portMUX_INITIALIZER_UNLOCKED;
+bool burstReady = false;
+volatile bool drainStop = false;
+SemaphoreHandle_t drainDone = nullptr;  // Given by the drain when it exits
+TaskHandle_t drainHandle = nullptr;
+uint32_t burstPeak = 0;        // Fill of the burst in progress, bytes
+uint32_t burstPeakFrames = 0;
+uint32_t burstPeakAt = 0;
+uint32_t burstMaxPeak = 0;     // Largest burst absorbed so far
+uint32_t burstMaxDrainMs = 0;
+
+SemaphoreHandle_t pcapLock = nullptr;  // pcapFile: WiFi task vs loop() syncs
+uint32_t lockDropped = 0;  // Frames dropped without a ring while pcapLock was held
+uint32_t bytesSinceSync = 0;
+uint32_t lastSync = 0;
+uint32_t syncCount = 0;
+
 #ifdef WEBUI
 extern void webui_init();
 #endif
@@ -45,73 +203,73 @@ extern void webui_init();
 // SD card error recovery retry count
 #define SD_RETRIES 3
 
+void flushPcapBuffer();
+
+void syncPcap() {
+    pcapFile.flush();
+    bytesSinceSync = 0;
+    lastSync = millis();
+    syncCount++;
+}
+
 void initPcapHeader() {
     for (int retry = 0; retry < SD_RETRIES; retry++) {
         pcapFile = SD_MMC.open(pcapFilename.c_str(), FILE_WRITE);
         if (pcapFile) {
-        uint32_t magic = 0xa1b2c3d4;
-        uint16_t version_major = 2;
-        uint16_t version_minor = 4;
-        int32_t thiszone = 0;
-        uint32_t sigfigs = 0;
-        uint32_t snaplen = 65535;
-        uint32_t network = 105;
-
-        pcapFile.write((uint8_t*)&magic, 4);
-        pcapFile.write((uint8_t*)&version_major, 2);
-        pcapFile.write((uint8_t*)&version_minor, 2);
-        pcapFile.write((uint8_t*)&thiszone, 4);
-        pcapFile.write((uint8_t*)&sigfigs, 4);
-        pcapFile.write((uint8_t*)&snaplen, 4);
-        pcapFile.write((uint8_t*)&network, 4);
-        pcapFile.close();
-        pcapInitialized = true;
-        break;  // Success, exit retry loop
-    } else {
-        Serial.println("[SD] Retry " + String(retry + 1) + " failed");
-        delay(100);
+            uint32_t magic = 0xa1b2c3d4;
+            uint16_t version_major = 2;
+            uint16_t version_minor = 4;
+            int32_t thiszone = 0;
+            uint32_t sigfigs = 0;
+            uint32_t snaplen = 65535;
+            uint32_t network = 105;
+
+            pcapFile.write((uint8_t*)&magic, 4);
+            pcapFile.write((uint8_t*)&version_major, 2);
+            pcapFile.write((uint8_t*)&version_minor, 2);
+            pcapFile.write((uint8_t*)&thiszone, 4);
+            pcapFile.write((uint8_t*)&sigfigs, 4);
+            pcapFile.write((uint8_t*)&snaplen, 4);
+            pcapFile.write((uint8_t*)&network, 4);
+            pcapFile.close();
+            pcapInitialized = true;
+            break;  // Success, exit retry loop
+        } else {
+            Serial.println("[SD] Retry " + String(retry + 1) + " failed");
+            delay(100);
+        }
+    }
+    if (!pcapInitialized) {
+        Serial.println("[SD] Init FAILED after " + String(SD_RETRIES) + " retries");
     }
-}
-if (!pcapInitialized) {
-    Serial.println("[SD] Init FAILED after " + String(SD_RETRIES) + " retries");
 }
 
-void writePcapPacket(const uint8_t* payload, uint16_t len) {
-    // Skip packet if buffer full or file not ready
-    if (!pcapInitialized || len > 2560) return;
-    
-    // Ensure we have enough space for packet + header
-    if (bufferPos + len + 16 >= PCAP_BUFFER_SIZE) {
-        flushPcapBuffer();
-    }
-    
-    // Add timestamp header
-    uint32_t ts_sec = micros() / 1000000;
-    uint32_t ts_usec = micros() % 1000000;
-    uint32_t incl_len = len;
-    uint32_t orig_len = len;
-    
-    memcpy(pcapBuffer + bufferPos, &ts_sec, 4);
-    bufferPos += 4;
-    memcpy(pcapBuffer + bufferPos, &ts_usec, 4);
-    bufferPos += 4;
-    memcpy(pcapBuffer + bufferPos, &incl_len, 4);
-    bufferPos += 4;
-    memcpy(pcapBuffer + bufferPos, &orig_len, 4);
-    bufferPos += 4;
-    
-    // Copy packet data
-    memcpy(pcapBuffer + bufferPos, payload, len);
-    bufferPos += len;
-    
-    // Flush buffer if it's getting full (90% full)
-    if (bufferPos > PCAP_BUFFER_SIZE * 9 / 10) {
-        flushPcapBuffer();
+// Copies into the SD write buffer, flushing as it fills
+void pcapAppend(const uint8_t* data, uint32_t len) {
+    while (len) {
+        uint32_t n = min(len, (uint32_t)(PCAP_BUFFER_SIZE - bufferPos));
+        memcpy(pcapBuffer + bufferPos, data, n);
+        bufferPos += n;
+        data += n;
+        len -= n;
+        if (bufferPos == PCAP_BUFFER_SIZE) flushPcapBuffer();
     }
 }
 
+// us: esp_timer time of reception - 64-bit, so timestamps don't wrap like micros()
+void writePcapPacket(const uint8_t* payload, uint16_t len, uint64_t us) {
+    PROBE("writePcapPacket");
+    // Skip packet if file not ready
+    if (!pcapInitialized || !pcapBuffer || len > 2560) return;
+
+    uint32_t header[4] = { (uint32_t)(us / 1000000), (uint32_t)(us % 1000000), len, len };
+    pcapAppend((uint8_t*)header, sizeof(header));
+    pcapAppend(payload, len);
+}
+
 void flushPcapBuffer() {
     if (bufferPos == 0) return;
+    PROBE("flushPcapBuffer");
     
     if (!pcapFile) {
         // Retry opening file
@@ -133,49 +291,623 @@ void flushPcapBuffer() {
     // Write with error checking
     size_t written = pcapFile.write(pcapBuffer, bufferPos);
     if (written != bufferPos) {
-        Serial.printf("[SD] Write incomplete: %u of %u bytes
-", written, bufferPos);
+        LOGW("[SD] Write incomplete: %u of %u bytes\n", written, bufferPos);
     }
-    pcapFile.flush();
     bufferPos = 0;
+
+    bytesSinceSync += written;
+    if (bytesSinceSync >= PCAP_SYNC_BYTES || millis() - lastSync >= PCAP_SYNC_MS) {
+        syncPcap();
+    }
+}
+
+// Time budget for quiet periods - the byte budget is checked on every flush
+void syncPcapIfDue() {
+    if (!pcapLock || xSemaphoreTake(pcapLock, 0) != pdTRUE) return;
+    if (millis() - lastSync >= PCAP_SYNC_MS && (bufferPos || bytesSinceSync)) {
+        flushPcapBuffer();
+        if (bytesSinceSync) syncPcap();
+    }
+    xSemaphoreGive(pcapLock);
+}
+
+// Callback and sync bursts: into the ring, or straight to the SD buffer
+// without one. There the lock may be held across an SD sync, so the frame
+// is dropped rather than stall the WiFi task
+void capturePacket(const uint8_t* payload, uint16_t len, uint64_t us) {
+    if (!BURST_RING_BYTES || !burstReady) {
+        if (xSemaphoreTake(pcapLock, 0) != pdTRUE) {
+            lockDropped++;
+            return;
+        }
+        writePcapPacket(payload, len, us);
+        xSemaphoreGive(pcapLock);
+        return;
+    }
+    portENTER_CRITICAL(&burstMux);
+    bool wasEmpty = !ring.entries;
+    burstPush(&ring, payload, len, us);
+    portEXIT_CRITICAL(&burstMux);
+    if (wasEmpty) xTaskNotifyGive(drainHandle);
+}
+
+// Logs a burst once the ring is empty again: how much it held at the peak
+// and how long writing that out took
+void burstTrack(uint32_t used, uint32_t entries) {
+    if (used > burstPeak) {
+        burstPeak = used;
+        burstPeakFrames = entries;
+        burstPeakAt = millis();
+    }
+    if (used || burstPeak < BURST_REPORT_BYTES) {
+        if (!used) burstPeak = 0;
+        return;
+    }
+    uint32_t drainMs = millis() - burstPeakAt;
+    if (burstPeak > burstMaxPeak) burstMaxPeak = burstPeak;
+    if (drainMs > burstMaxDrainMs) burstMaxDrainMs = drainMs;
+    LOGI("[BURST] Absorbed %lu KB (%lu frames), drained in %lu ms | Dropped %lu | Evicted %lu | Truncated %lu\n",
+         burstPeak / 1024, burstPeakFrames, drainMs, ring.stats.dropped, ring.stats.evicted,
+         ring.stats.truncated);
+    burstPeak = 0;
+}
+
+// One record from the ring into the SD buffer (pcapLock held); 0 when the
+// ring is empty or the record doesn't fit
+uint32_t takeRecord(uint32_t* used, uint32_t* entries) {
+    portENTER_CRITICAL(&burstMux);
+    *used = ring.used;
+    *entries = ring.entries;
+    uint32_t len = burstTake(&ring, pcapBuffer + bufferPos, PCAP_BUFFER_SIZE - bufferPos);
+    portEXIT_CRITICAL(&burstMux);
+    bufferPos += len;
+    return len;
+}
+
+// Empties the ring into the SD buffer one record at a time, so the spinlock
+// is only held for one copy. Runs on core 1, away from the WiFi task.
+void drainTask(void* arg) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PCAP_SYNC_MS));
+        uint32_t len;
+        do {
+            uint32_t used, entries;
+            xSemaphoreTake(pcapLock, portMAX_DELAY);
+            len = takeRecord(&used, &entries);
+            if (!len && entries) {
+                if (!drainStop && !powerAdmit()) {
+                    // Throttled: the ring holds the burst a while longer
+                    xSemaphoreGive(pcapLock);
+                    vTaskDelay(pdMS_TO_TICKS(DRAIN_DEFER_MS));
+                    len = 1;
+                    continue;
+                }
+                flushPcapBuffer();
+                len = takeRecord(&used, &entries);
+            }
+            xSemaphoreGive(pcapLock);
+            if (CaptureProfile::metrics) burstTrack(len ? used : 0, entries);
+        } while (len);
+        if (drainStop) break;
+    }
+    xSemaphoreGive(drainDone);
+    vTaskDelete(nullptr);
+}
+
+// The ring and its drain task, once the capture file is set up. Without
+// PSRAM the callback keeps writing to the SD buffer directly.
+void initBurst() {
+    if (!BURST_RING_BYTES) return;
+    if (!arenaInit(&burstArena, "sniffer-ring", BURST_RING_BYTES, ARENA_PSRAM)) {
+        Serial.println("[BURST] No ring - writing directly");
+        return;
+    }
+    burstInit(&ring, (uint8_t*)arenaAlloc(&burstArena, BURST_RING_BYTES), BURST_RING_BYTES,
+              node.burstPolicy);
+    drainStop = false;
+    drainDone = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(drainTask, "drain", DRAIN_STACK, nullptr, 1, &drainHandle, 1);
+    burstReady = true;
+    Serial.printf("[BURST] %u KB ring, drop %s when full\n", BURST_RING_BYTES / 1024,
+                  BURST_POLICY_NAMES[node.burstPolicy]);
+}
+
+// Cuts a torn record off the end of the previous capture so it stays readable
+void recoverLastCapture() {
+    File last = SD_MMC.open(PCAP_LAST_FILE, FILE_READ);
+    if (!last) return;
+    String name = last.readStringUntil('\n');
+    name.trim();
+    last.close();
+
+    File f = SD_MMC.open(name.c_str(), FILE_READ);
+    if (!f) return;
+    size_t size = f.size();
+    uint8_t* chunk = (uint8_t*)malloc(PCAP_SCAN_CHUNK);
+    if (!chunk) {
+        f.close();
+        return;
+    }
+
+    uint32_t start = millis();
+    auto read = [&f](size_t offset, uint8_t* buf, size_t len) -> size_t {
+        return f.seek(offset) ? f.read(buf, len) : 0;
+    };
+    PcapScan scan = pcapScan(read, size, chunk, PCAP_SCAN_CHUNK);
+    f.close();
+    free(chunk);
+
+    if (scan.valid == size) {
+        Serial.printf("[RECOVER] %s OK (%u records, %lu ms)\n", name.c_str(), scan.records, millis() - start);
+        return;
+    }
+    if (scan.valid == 0) {
+        Serial.printf("[RECOVER] %s has no intact header - removed\n", name.c_str());
+        SD_MMC.remove(name.c_str());
+        return;
+    }
+    String path = String(SD_MOUNT_POINT) + name;
+    bool ok = truncate(path.c_str(), scan.valid) == 0;
+    Serial.printf("[RECOVER] %s: cut %u torn bytes after %u records%s (%lu ms)\n", name.c_str(),
+                  size - scan.valid, scan.records, ok ? "" : " - truncate FAILED", millis() - start);
+}
+
+// Rare path: says what differs between the stored fingerprint and this beacon
+void reportBeaconChange(const uint8_t* bssid, ApInfo* ap, const BeaconPrint& now,
+                        const uint8_t* f, uint16_t len) {
+    beaconChanges++;
+    if (++ap->changes > BEACON_CHANGE_LOG_MAX) return;
+    const BeaconPrint& was = ap->print;
+    if (now.channel != was.channel) {
+        LOGI("[CHANGE] %02X:%02X:%02X:%02X:%02X:%02X | Channel %d -> %d\n", bssid[0], bssid[1],
+             bssid[2], bssid[3], bssid[4], bssid[5], was.channel, now.channel);
+    }
+    if (now.ssid != was.ssid) {
+        Dot11BeaconInfo info = dot11BeaconInfo(f, len);
+        char ssid[33] = {0};
+        if (info.ssid) memcpy(ssid, info.ssid, info.ssidLen);
+        LOGI("[CHANGE] %02X:%02X:%02X:%02X:%02X:%02X | SSID -> %s\n", bssid[0], bssid[1], bssid[2],
+             bssid[3], bssid[4], bssid[5], logText(ssid));
+    }
+    if (now.security != was.security) {
+        char name[32];
+        LOGI("[CHANGE] %02X:%02X:%02X:%02X:%02X:%02X | Security -> %s\n", bssid[0], bssid[1],
+             bssid[2], bssid[3], bssid[4], bssid[5],
+             logText(beaconSecurityName(beaconSecurity(f, len), name, sizeof(name))));
+    }
+    if (now.other != was.other) {
+        LOGI("[CHANGE] %02X:%02X:%02X:%02X:%02X:%02X | IEs changed\n", bssid[0], bssid[1],
+             bssid[2], bssid[3], bssid[4], bssid[5]);
+    }
+    if (ap->changes == BEACON_CHANGE_LOG_MAX) {
+        LOGI("[CHANGE] %02X:%02X:%02X:%02X:%02X:%02X | Further changes counted only\n", bssid[0],
+             bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+    }
+}
+
+// New BSSIDs go into the inventory as [NEW]; a known one costs an IE walk
+// and a fingerprint compare, and is only decoded when that differs
+void trackBeacon(const uint8_t* payload, uint16_t len) {
+    const uint8_t* bssid = &payload[10];
+    BeaconPrint print = beaconPrint(payload, len);
+    bool added;
+    ApInfo* ap = macMapInsert(&seenAPs, bssid, &added);
+    if (!ap) return;  // Inventory full
+    if (added) {
+        ap->print = print;
+        int ssid_len = payload[37];
+        char ssid[33] = {0};
+        if (ssid_len > 0 && ssid_len <= 32) memcpy(ssid, &payload[38], ssid_len);
+
+        uint8_t ch = print.channel ? print.channel : currentChannel;  // Tracked channel if the beacon has none
+
+        LOGI("\n[NEW] %s | %02X:%02X:%02X:%02X:%02X:%02X | CH: %d\n> ", logText(ssid),
+             bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5], ch);
+        return;
+    }
+    if (beaconPrintEqual(ap->print, print)) return;
+    reportBeaconChange(bssid, ap, print, payload, len);
+    ap->print = print;
+}
+
+// Frame receive time on the esp_timer clock. rx_ctrl.timestamp is the MAC's
+// 32-bit microsecond clock at reception, free of the WiFi task's scheduling
+// delay that esp_timer_get_time() in the callback adds. Both clocks run off
+// the same crystal, so their difference is a constant plus that delay; the
+// least difference seen (re-estimated each RX_LAG_WINDOW_MS in case they
+// drift apart) is taken as the constant.
+uint64_t rxTimeUs(const wifi_pkt_rx_ctrl_t& rx) {
+    uint64_t now = esp_timer_get_time();
+    uint32_t lag = (uint32_t)now - rx.timestamp;
+    if (!rxLagSet) {
+        rxLag = lag;
+        rxLagSet = true;
+        rxLagWindowAt = now;
+    }
+    int32_t late = (int32_t)(lag - rxLag);
+    if (late < 0) {
+        rxLag = lag;
+        late = 0;
+    }
+    if (late < rxLagWindowMin) rxLagWindowMin = late;
+    if (now - rxLagWindowAt >= RX_LAG_WINDOW_MS * 1000ULL) {
+        rxLag += rxLagWindowMin;
+        late -= rxLagWindowMin;
+        rxLagWindowMin = INT32_MAX;
+        rxLagWindowAt = now;
+    }
+    return late < RX_LAG_MAX_US ? now - late : now;
 }
 
+// Instantiated for the build profile (profile.h); P::ledActivity and
+// P::metrics are constants, so what they turn off is not compiled in
+template <typename P>
 void sniffer_callback(void* buf, wifi_promiscuous_pkt_type_t type) {
+    PROBE("sniffer_callback");
     wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
+    // MISC packets carry no 802.11 frame; a nonzero rx_state is a frame that
+    // failed its FCS, with addresses that can't be trusted
+    if (type == WIFI_PKT_MISC || pkt->rx_ctrl.rx_state != 0) return;
     uint8_t* payload = pkt->payload;
     uint16_t len = pkt->rx_ctrl.sig_len;
-    packetCount++;
+    if (P::metrics) packetCount++;
 
-    if (type == WIFI_PKT_MGMT && payload[0] == 0x80) {
-        uint8_t* bssid = &payload[10];
-        char macStr[18];
-        sprintf(macStr, "%02X:%02X:%02X:%02X:%02X:%02X", 
-                bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+    if (type == WIFI_PKT_MGMT && payload[0] == 0x80) trackBeacon(payload, len);
 
-        if (seenMACs.find(String(macStr)) == seenMACs.end()) {
-            seenMACs.insert(String(macStr));
-            int ssid_len = payload[37];
-            char ssid[33] = {0};
-            if (ssid_len > 0 && ssid_len <= 32) memcpy(ssid, &payload[38], ssid_len);
+    if (surveyRunning) {
+        const wifi_pkt_rx_ctrl_t& rx = pkt->rx_ctrl;
+        uint8_t ch = rx.channel > 0 && rx.channel < SURVEY_CHANNELS ? rx.channel : currentChannel;
+        uint32_t airtime = surveyAirtimeUs(rx.sig_mode != 0, rx.rate, rx.mcs, rx.cwb, rx.sgi, len);
+        portENTER_CRITICAL(&surveyMux);
+        surveyAdd(&surveyBanks[surveyActive][ch], payload, len, rx.rssi, rx.noise_floor, airtime);
+        portEXIT_CRITICAL(&surveyMux);
+    }
+
+    if (clientsRunning) {
+        const wifi_pkt_rx_ctrl_t& rx = pkt->rx_ctrl;
+        uint8_t ch = rx.channel > 0 && rx.channel < SURVEY_CHANNELS ? rx.channel : currentChannel;
+        portENTER_CRITICAL(&clientMux);
+        clientAdd(&clientBanks[clientActive], payload, len, rx.rssi, ch);
+        portEXIT_CRITICAL(&clientMux);
+    }
+
+    // clients= can widen the filter past the profile's frame types; the
+    // pcap still keeps only the profile's
+    bool profileType = (1 << type) & P::frameTypes;
+    if (pcapInitialized && profileType && len > 0 && len < 2560) {
+        if (P::ledActivity) digitalWrite(LED_PIN, LOW);
+        capturePacket(payload, len, rxTimeUs(pkt->rx_ctrl));
+        if (P::ledActivity) digitalWrite(LED_PIN, HIGH);
+    }
+}
+
+// The pcap buffer is required. The AP map falls back to internal RAM at a
+// quarter the size; without either, [NEW] and change reports are off
+bool planMemory() {
+    if (!arenaInit(&internalArena, "sniffer", ARENA_SIZE(PCAP_BUFFER_SIZE), ARENA_INTERNAL_DMA)) return false;
+    pcapBuffer = (uint8_t*)arenaAlloc(&internalArena, PCAP_BUFFER_SIZE);
+    uint32_t aps = SNIFFER_MAX_APS;
+    bool map = arenaInit(&psramArena, "sniffer-aps", ARENA_SIZE(macMapBytes<ApInfo>(aps)), ARENA_PSRAM);
+    if (!map) {
+        aps = SNIFFER_MAX_APS / 4;
+        map = arenaInit(&psramArena, "sniffer-aps", ARENA_SIZE(macMapBytes<ApInfo>(aps)), ARENA_INTERNAL);
+    }
+    if (map) macMapInit(&seenAPs, arenaAlloc(&psramArena, macMapBytes<ApInfo>(aps)), aps);
+    else Serial.println("[MEM] No AP table - [NEW] and beacon change reports off");
+    return true;
+}
+
+// "channels=1,6,11" or "channels=1-5,13"
+uint16_t parseChannels(const String& list) {
+    uint16_t mask = 0;
+    const char* p = list.c_str();
+    while (*p) {
+        char* end;
+        long from = strtol(p, &end, 10);
+        long to = from;
+        if (*end == '-') to = strtol(end + 1, &end, 10);
+        for (long ch = from; ch <= to; ch++) {
+            if (ch >= 1 && ch <= 13) mask |= 1 << ch;
+        }
+        if (*end != ',') break;
+        p = end + 1;
+    }
+    return mask;
+}
+
+void readNodeConfig() {
+    node = { -1, CHANNELS_ALL, HOP_DWELL_MS, false, 0, BURST_DROP_NEWEST, 0 };
+    File f = SD_MMC.open(NODE_CONFIG_FILE, FILE_READ);
+    if (!f) return;
+    while (f.available()) {
+        String line = f.readStringUntil('\n');
+        line.trim();
+        int eq = line.indexOf('=');
+        if (eq < 0) continue;
+        String key = line.substring(0, eq), value = line.substring(eq + 1);
+        if (key == "node") node.id = value.toInt();
+        else if (key == "channels") node.channels = parseChannels(value);
+        else if (key == "dwell") node.dwellMs = value.toInt();
+        else if (key == "sync") node.syncSource = value.toInt() != 0;
+        else if (key == "survey") node.surveyS = value.toInt();
+        else if (key == "clients") node.clientsS = value.toInt();
+        else if (key == "burst") {
+            for (uint8_t p = 0; p < 3; p++) {
+                if (value == BURST_POLICY_NAMES[p]) node.burstPolicy = p;
+            }
+        }
+    }
+    f.close();
+    if (!node.channels) node.channels = CHANNELS_ALL;
+    if (node.dwellMs < 50) node.dwellMs = 50;
+    if (node.surveyS) node.surveyS = constrain(node.surveyS, SURVEY_MIN_S, SURVEY_MAX_S);
+    if (node.clientsS) node.clientsS = constrain(node.clientsS, CLIENTS_MIN_S, CLIENTS_MAX_S);
+
+    Serial.printf("[NODE] %d | Channels:", node.id);
+    for (int ch = 1; ch <= 13; ch++) {
+        if (node.channels & (1 << ch)) Serial.printf(" %d", ch);
+    }
+    Serial.printf(" | Dwell %lu ms%s", node.dwellMs, node.syncSource ? " | Sync source" : "");
+    if (node.surveyS) Serial.printf(" | Survey every %lu s", node.surveyS);
+    if (node.clientsS) Serial.printf(" | Clients every %lu s", node.clientsS);
+    Serial.println();
+}
+
+// Transmitter sets for both banks, and a new /survey file
+bool initSurvey(const String& stamp) {
+    size_t setBytes = macSetBytes(SURVEY_MAX_TRANSMITTERS);
+    if (!arenaInit(&surveyArena, "survey-tx", 2 * 13 * ARENA_SIZE(setBytes), ARENA_PSRAM)) return false;
+    for (int b = 0; b < 2; b++) {
+        for (int ch = 1; ch <= 13; ch++) {
+            SurveyChannel* c = &surveyBanks[b][ch];
+            macSetInit(&c->transmitters, arenaAlloc(&surveyArena, setBytes), SURVEY_MAX_TRANSMITTERS);
+            surveyClear(c);
+        }
+    }
+
+    SD_MMC.mkdir("/survey");
+    surveyFilename = "/survey/" + stamp + ".srv";
+    for (int n = 1; SD_MMC.exists(surveyFilename.c_str()); n++) {
+        surveyFilename = "/survey/" + stamp + "-" + String(n) + ".srv";
+    }
+    surveyFile = SD_MMC.open(surveyFilename.c_str(), FILE_WRITE);
+    if (!surveyFile) return false;
+    SurveyHeader header;
+    surveyHeader(&header);
+    surveyFile.write((uint8_t*)&header, sizeof(header));
+    surveyFile.flush();
+    lastSurvey = millis();
+    surveyRunning = true;
+    Serial.printf("Survey to: %s\n", surveyFilename.c_str());
+    return true;
+}
+
+// Called from loop() with the time spent on ch since the last call
+void surveyListen(uint8_t ch, uint32_t ms) {
+    if (node.surveyS && ch > 0 && ch < SURVEY_CHANNELS) surveyBanks[surveyActive][ch].listenMs += ms;
+}
+
+void surveyFlushIfDue(uint32_t now) {
+    if (!surveyRunning || now - lastSurvey < node.surveyS * 1000) return;
+    uint16_t intervalS = (now - lastSurvey) / 1000;
+    lastSurvey = now;
 
-            uint8_t ch = currentChannel;  // Use tracked channel instead of WiFi.channel() for promiscuous mode
+    uint8_t done = surveyActive;
+    portENTER_CRITICAL(&surveyMux);
+    surveyActive = done ^ 1;
+    portEXIT_CRITICAL(&surveyMux);
 
-            Serial.printf("\n[NEW] %s | %s | CH: %d\n> ", ssid, macStr, ch);
+    uint32_t t = time(nullptr);
+    uint8_t flags = t > CLOCK_VALID_AFTER ? SURVEY_CLOCK_SET : 0;
+    uint8_t busiest = 0;
+    uint32_t busiestPct = 0;
+    for (int ch = 1; ch <= 13; ch++) {
+        SurveyChannel* c = &surveyBanks[done][ch];
+        if (!c->listenMs && !c->frames) continue;
+        SurveyRecord rec;
+        surveyRecord(&rec, c, ch, t, now / 1000, intervalS, flags);
+        surveyFile.write((uint8_t*)&rec, sizeof(rec));
+        surveyRecords++;
+        uint32_t pct = c->listenMs ? c->airtimeUs / 10 / c->listenMs : 0;
+        if (pct >= busiestPct) {
+            busiest = ch;
+            busiestPct = pct;
         }
+        surveyClear(c);
+    }
+    surveyFile.flush();
+    LOGI("[SURVEY] %lu records | Busiest: CH %d at %lu%% airtime\n", surveyRecords, busiest, busiestPct);
+}
+
+// BSS and station tables for both banks, and a new /clients file
+bool initClients(const String& stamp) {
+    size_t bankBytes = clientBankBytes(CLIENT_MAX_BSS, CLIENT_MAX_STATIONS);
+    if (!arenaInit(&clientArena, "sniffer-clients", 2 * ARENA_SIZE(bankBytes), ARENA_PSRAM)) return false;
+    for (int b = 0; b < 2; b++) {
+        clientInit(&clientBanks[b], arenaAlloc(&clientArena, bankBytes), CLIENT_MAX_BSS, CLIENT_MAX_STATIONS);
     }
 
-    if (pcapInitialized && len > 0 && len < 2560) {
-        digitalWrite(LED_PIN, LOW);
-        writePcapPacket(payload, len);
-        digitalWrite(LED_PIN, HIGH);
+    SD_MMC.mkdir("/clients");
+    String name = "/clients/" + stamp + ".cli";
+    for (int n = 1; SD_MMC.exists(name.c_str()); n++) {
+        name = "/clients/" + stamp + "-" + String(n) + ".cli";
     }
+    clientFile = SD_MMC.open(name.c_str(), FILE_WRITE);
+    if (!clientFile) return false;
+    ClientHeader header;
+    clientHeader(&header);
+    clientFile.write((uint8_t*)&header, sizeof(header));
+    clientFile.flush();
+    lastClients = millis();
+    clientsRunning = true;
+    Serial.printf("Clients to: %s\n", name.c_str());
+    return true;
+}
+
+void clientsFlushIfDue(uint32_t now) {
+    if (!clientsRunning || now - lastClients < node.clientsS * 1000) return;
+    uint16_t intervalS = (now - lastClients) / 1000;
+    lastClients = now;
+
+    uint8_t done = clientActive;
+    portENTER_CRITICAL(&clientMux);
+    clientActive = done ^ 1;
+    portEXIT_CRITICAL(&clientMux);
+
+    ClientBank* b = &clientBanks[done];
+    uint32_t t = time(nullptr);
+    uint8_t flags = t > CLOCK_VALID_AFTER ? CLIENT_CLOCK_SET : 0;
+    macMapForEach(&b->bss, [&](const uint8_t* bssid, ClientBss* c) {
+        ClientBssRecord rec;
+        clientBssRecord(&rec, b, bssid, c, t, now / 1000, intervalS, flags);
+        clientFile.write((uint8_t*)&rec, sizeof(rec));
+        clientRecords++;
+    });
+    ClientSiteRecord site;
+    clientSiteRecord(&site, b, t, now / 1000, intervalS, flags);
+    clientFile.write((uint8_t*)&site, sizeof(site));
+    clientRecords++;
+    clientFile.flush();
+    LOGI("[CLIENTS] %u BSSIDs | %u stations: %u associated, %u probing (%u randomized) | %lu records\n",
+         site.bssids, site.stations, site.associated, site.probing, site.probingRandom, clientRecords);
+    clientClear(b);
+}
+
+void initStorage() {
+    if (sdBegin()) {
+        Serial.println("SD: OK");
+        SD_MMC.mkdir("/sniffer");
+        recoverLastCapture();
+        readNodeConfig();
+        if (node.id >= 0) {
+            pcapFilename = "/sniffer/n" + String(node.id) + "-" + pcapFilename.substring(9);
+        }
+        // pcapFilename is /sniffer/<stamp>.pcap
+        String stamp = pcapFilename.substring(9, pcapFilename.length() - 5);
+        if (node.clientsS && !initClients(stamp)) {
+            Serial.println("[CLIENTS] Init FAILED");
+        }
+        if (node.surveyS) {
+            if (!initSurvey(stamp)) {
+                Serial.println("[SURVEY] Init FAILED");
+            }
+            return;
+        }
+
+        // Without a set clock every boot gets the same name - don't overwrite
+        String base = pcapFilename.substring(0, pcapFilename.length() - 5);
+        for (int n = 1; SD_MMC.exists(pcapFilename.c_str()); n++) {
+            pcapFilename = base + "-" + String(n) + ".pcap";
+        }
+        File last = SD_MMC.open(PCAP_LAST_FILE, FILE_WRITE);
+        if (last) {
+            last.println(pcapFilename);
+            last.close();
+        }
+
+        initPcapHeader();
+        if (pcapInitialized) initBurst();
+        lastSync = millis();
+        Serial.printf("Saving to: %s\n", pcapFilename.c_str());
+    } else {
+        Serial.println("SD: FAILED");
+    }
+}
+
+// Next channel of this node's subset after ch (ch itself when locked to one)
+uint8_t nextChannel(uint8_t ch) {
+    for (int i = 1; i <= 13; i++) {
+        uint8_t next = (ch + i - 1) % 13 + 1;
+        if (node.channels & (1 << next)) return next;
+    }
+    return ch;
+}
+
+// One sync beacon per channel, each stamped just before it goes out and
+// recorded in our own capture with that same time
+void sendSyncBurst() {
+    uint8_t frame[SYNC_BEACON_MAX];
+    syncSeq++;
+    for (uint8_t ch = 1; ch <= 13; ch++) {
+        currentChannel = ch;
+        esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
+        uint64_t us = esp_timer_get_time();
+        size_t len = syncBeaconBuild(frame, node.id, syncSeq, ch, us);
+        esp_wifi_80211_tx(WIFI_IF_AP, frame, len - DOT11_FCS_SIZE, false);
+        capturePacket(frame, len, us);
+    }
+}
+
+uint8_t hopChannel = 0;
+uint32_t tunedAt = 0;
+
+void tune(uint8_t ch) {
+    currentChannel = ch;
+    esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
+}
+
+void hop(uint32_t now) {
+    surveyListen(hopChannel, now - tunedAt);
+    uint8_t next = nextChannel(hopChannel);
+    if (next != hopChannel) {
+        hopChannel = next;
+        tune(hopChannel);
+    }
+    tunedAt = now;
+}
+
+void syncBurst(uint32_t now) {
+    if (!pcapInitialized) return;
+    surveyListen(hopChannel, now - tunedAt);
+    sendSyncBurst();
+    tune(hopChannel);
+    tunedAt = millis();
+}
+
+void status(uint32_t now) {
+    Serial.printf("[STATUS] CH: %d | Packets: %lu | Buffer: %u/%u | Syncs: %lu | APs: %lu | Changes: %lu\n",
+                  hopChannel, packetCount, bufferPos, PCAP_BUFFER_SIZE, syncCount, seenAPs.count,
+                  beaconChanges);
+    if (burstReady) {
+        Serial.printf("[BURST] Ring %lu KB | Peak %lu KB | Largest burst %lu KB, drained in %lu ms | Dropped %lu\n",
+                      ring.used / 1024, ring.stats.peakUsed / 1024, burstMaxPeak / 1024, burstMaxDrainMs,
+                      ring.stats.dropped);
+    }
+    if (lockDropped) Serial.printf("[PCAP] Dropped %lu while the SD was busy\n", lockDropped);
+    ledBlink(1, 50);
+}
+
+void housekeeping(uint32_t now) {
+    syncPcapIfDue();
+    surveyFlushIfDue(now);
+    clientsFlushIfDue(now);
+    PROBE_REPORT(now);
+    heapWatchTick(now);
+    powerWatchTick(now);
+}
+
+void schedulerReport(uint32_t now) {
+    schedReport(Serial);
+}
+
+// loop() only dispatches these (scheduler.h); the hop runs on its own tick
+// grid, so status output and SD flushes no longer stretch the dwell
+void startEvents() {
+    hop(millis());
+    schedEvery("hop", node.dwellMs, hop);
+    if (node.syncSource) schedEvery("sync", SYNC_INTERVAL_MS, syncBurst);
+    schedEvery("status", STATUS_MS, status);
+    schedEvery("house", HOUSEKEEPING_MS, housekeeping);
+    schedEvery("report", SCHED_REPORT_MS, schedulerReport);
+    ledEvent = schedEvent("led", ledStep);
 }
 
 void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+    powerWatchInit();
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
     Serial.begin(115200);
+    binlogBegin();
 
     time_t now = time(nullptr);
     struct tm* ti = localtime(&now);
@@ -184,23 +916,45 @@ void setup() {
              ti->tm_year + 1900, ti->tm_mon + 1, ti->tm_mday,
              ti->tm_hour, ti->tm_min, ti->tm_sec);
     pcapFilename = String(fname);
-
-    if (SD_MMC.begin("/sdcard", true)) {
-        Serial.println("SD: OK");
-        SD_MMC.mkdir("/sniffer");
-        initPcapHeader();
-        Serial.printf("Saving to: %s\n", fname);
-    } else {
-        Serial.println("SD: FAILED");
+    if (!pcapLock) pcapLock = xSemaphoreCreateMutex();
+    if (!planMemory()) {
+        Serial.println("[MEM] No pcap buffer - capture not started");
+        ledBlink(5, 200);
+        return;
     }
 
+    // SD mount overlaps WiFi start; packets are only written once the
+    // header is down (pcapInitialized)
+    BootTask sd;
+    bootStart(&sd, "sd", initStorage, 0);
+
 #ifdef WEBUI
     webui_init();
 #endif
 
+    int p = bootPhaseBegin("wifi");
     WiFi.mode(WIFI_AP_STA);
     esp_wifi_set_promiscuous(true);
-    esp_wifi_set_promiscuous_rx_cb(&sniffer_callback);
+    esp_wifi_set_promiscuous_rx_cb(&sniffer_callback<CaptureProfile>);
+    bootPhaseEnd(p);
+
+    bootWait(&sd);
+    // Survey counts control frames (ACK, RTS / CTS) too - they take airtime.
+    // Not MASK_ALL: that adds MISC packets and frames with a bad FCS
+    uint32_t frameTypes = CaptureProfile::frameTypes;
+    if (node.surveyS) {
+        frameTypes = WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_CTRL | WIFI_PROMIS_FILTER_MASK_DATA;
+    }
+    // Client activity is built from data frames, even in a mgmt-only profile
+    if (node.clientsS) frameTypes |= WIFI_PROMIS_FILTER_MASK_DATA;
+    wifi_promiscuous_filter_t filter = { frameTypes };
+    esp_wifi_set_promiscuous_filter(&filter);
+    bootProfilePrint();
+    Serial.printf("[PROFILE] %s\n", CaptureProfile::name);
+    arenaReport();
+    heapWatchBegin();
+    powerWatchBegin("SD writes");
+    startEvents();
     Serial.println("SNIFFER RUNNING");
     
     // LED pattern: fast blink to show running
@@ -208,22 +962,50 @@ void setup() {
 }
 
 void loop() {
-    static uint8_t ch = 1;
-    static uint32_t lastStatus = 0;
-    
-    currentChannel = ch;
-    esp_wifi_set_channel(ch, WIFI_SECOND_CHAN_NONE);
-    ch = (ch % 13) + 1;
-    
-    // Status reporting every 5 seconds
-    if (millis() - lastStatus > 5000) {
-        lastStatus = millis();
-        Serial.printf("[STATUS] CH: %d | Packets: %lu | Buffer: %u/%u
-", 
-                      ch, packetCount, bufferPos, PCAP_BUFFER_SIZE);
-        // Blink once per channel change
-        ledBlink(1, 50);
+    schedRun();
+}
+
+// Stops capture and releases everything setup() took, for mode switching
+void teardown() {
+    schedStop();
+    hopChannel = 0;
+    ledToggles = 0;
+    esp_wifi_set_promiscuous(false);
+    esp_wifi_set_promiscuous_rx_cb(nullptr);
+    if (burstReady) {
+        // The drain writes out what the ring still holds before it exits
+        burstReady = false;
+        drainStop = true;
+        xTaskNotifyGive(drainHandle);
+        xSemaphoreTake(drainDone, portMAX_DELAY);
+        vSemaphoreDelete(drainDone);
+        drainDone = nullptr;
+        drainHandle = nullptr;
+        arenaFree(&burstArena);
+        burstMaxPeak = burstMaxDrainMs = burstPeak = 0;
     }
-    
-    delay(1000);
+    flushPcapBuffer();
+    if (pcapFile) pcapFile.close();
+    bytesSinceSync = 0;
+    lockDropped = 0;
+    rxLagSet = false;
+    rxLagWindowMin = INT32_MAX;
+    pcapInitialized = false;
+    surveyRunning = false;
+    if (surveyFile) surveyFile.close();
+    arenaFree(&surveyArena);
+    memset(surveyBanks, 0, sizeof(surveyBanks));
+    clientsRunning = false;
+    if (clientFile) clientFile.close();
+    arenaFree(&clientArena);
+    memset(clientBanks, 0, sizeof(clientBanks));
+    arenaFree(&internalArena);
+    arenaFree(&psramArena);
+    pcapBuffer = nullptr;
+    macMapInit(&seenAPs, nullptr, 0);
+    beaconChanges = 0;
+    WiFi.mode(WIFI_OFF);
+    ledSolid(false);
 }
+
+MODULE_END
@@ -7,10 +7,29 @@
 #endif
 
 #include <WiFi.h>
+#include "esp_timer.h"
 #include "esp_http_server.h"
 
+#include "module.h"
+#include "boot_profile.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "power_watch.h"
+
 #define LED_PIN 33
 
+// /ws: each JPEG is one binary WebSocket message (4-byte little-endian
+// sequence number, then the JPEG), and the viewer acks the sequence number
+// once the frame is drawn. The sender keeps at most WS_MAX_IN_FLIGHT frames
+// unacked, so a slow link or browser lowers the frame rate instead of
+// queueing stale frames. Needs CONFIG_HTTPD_WS_SUPPORT (on in arduino-esp32
+// 2.x).
+#define WS_MAX_IN_FLIGHT 2
+#define WS_HEADER_SIZE 4
+#define WS_ACK_TIMEOUT_MS 2000  // Unacked this long: assume the acks were lost
+#define WS_STACK 4096
+#define STATUS_INTERVAL 5000
+
 #define PWDN_GPIO_NUM     32
 #define RESET_GPIO_NUM    -1
 #define XCLK_GPIO_NUM      0
@@ -28,6 +47,31 @@
 #define HREF_GPIO_NUM     23
 #define PCLK_GPIO_NUM     22
 
+MODULE_BEGIN(stream)
+
+httpd_handle_t server = NULL;
+volatile bool streaming = true;  // Cleared by teardown() to end open streams
+
+// WebSocket viewer (one at a time); wsMux guards the in-flight slots, which
+// the sender task fills and the server task's ack handler empties
+int wsFd = -1;
+uint32_t wsSeq = 0;
+uint8_t wsInFlight = 0;
+uint32_t wsSentSeq[WS_MAX_IN_FLIGHT];
+int64_t wsCaptureUs[WS_MAX_IN_FLIGHT];  // Camera timestamp of each unacked frame
+uint32_t wsLastAck = 0;
+portMUX_TYPE wsMux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t wsTaskHandle = nullptr;
+SemaphoreHandle_t wsDone = nullptr;  // Given by the sender when it exits
+
+// Since the last status line
+uint32_t wsFrames = 0;
+uint32_t wsBytes = 0;
+uint32_t wsStalls = 0;     // Waits for an ack with WS_MAX_IN_FLIGHT unacked
+uint64_t wsLatencySumUs = 0;
+uint32_t wsLatencyMaxUs = 0;
+uint32_t wsAcks = 0;
+
 static const char PROGMEM INDEX_HTML[] = R"rawliteral(
 <!DOCTYPE html>
 <html>
@@ -41,6 +85,84 @@ img { max-width: 100%; max-height: 100vh; }
 </head>
 <body>
 <img id="stream" src="/stream">
+<p><a href="/view" style="color:#888">WebSocket viewer</a></p>
+<div id="clock" style="display:none;position:fixed;top:0;left:0;font:48px monospace;color:#0f0;background:#000"></div>
+<script>
+// /#clock: point the camera at this page; live clock minus the clock in the
+// picture is the glass-to-glass latency
+if (location.hash == '#clock') {
+  const c = document.getElementById('clock');
+  c.style.display = 'block';
+  (function tick() { c.textContent = Date.now() % 100000; requestAnimationFrame(tick); })();
+}
+</script>
+</body>
+</html>
+)rawliteral";
+
+static const char PROGMEM VIEW_HTML[] = R"rawliteral(
+<!DOCTYPE html>
+<html>
+<head>
+<title>ESP-Kit WebSocket Stream</title>
+<meta name="viewport" content="width=device-width, initial-scale=1">
+<style>
+body { margin: 0; background: #111; text-align: center; color: #888; font: 14px monospace; }
+canvas { max-width: 100%; max-height: 95vh; }
+#clock { display: none; position: fixed; top: 0; left: 0; font-size: 48px; color: #0f0; background: #000; }
+</style>
+</head>
+<body>
+<canvas id="view"></canvas>
+<div id="stats">connecting</div>
+<div id="clock"></div>
+<script>
+const canvas = document.getElementById('view'), ctx = canvas.getContext('2d');
+const stats = document.getElementById('stats');
+let frames = 0, bytes = 0, since = performance.now();
+
+function draw(data) {
+  const seq = new DataView(data).getUint32(0, true);
+  const jpeg = new Blob([new Uint8Array(data, 4)], { type: 'image/jpeg' });
+  return createImageBitmap(jpeg).then(img => {
+    if (canvas.width != img.width) { canvas.width = img.width; canvas.height = img.height; }
+    ctx.drawImage(img, 0, 0);
+    img.close();
+    frames++;
+    bytes += data.byteLength;
+    return seq;
+  }, () => seq);
+}
+
+function connect() {
+  const ws = new WebSocket('ws://' + location.host + '/ws');
+  ws.binaryType = 'arraybuffer';
+  let queue = Promise.resolve();
+  // Draw in arrival order, ack each frame once it is on the canvas
+  ws.onmessage = e => {
+    queue = queue.then(() => draw(e.data)).then(seq => {
+      const ack = new DataView(new ArrayBuffer(4));
+      ack.setUint32(0, seq, true);
+      if (ws.readyState == 1) ws.send(ack.buffer);
+    });
+  };
+  ws.onclose = () => { stats.textContent = 'reconnecting'; setTimeout(connect, 1000); };
+}
+
+setInterval(() => {
+  const s = (performance.now() - since) / 1000;
+  if (frames) stats.textContent = (frames / s).toFixed(1) + ' fps | ' + (bytes / s / 1024).toFixed(0) + ' KB/s';
+  frames = bytes = 0;
+  since = performance.now();
+}, 2000);
+
+if (location.hash == '#clock') {
+  const c = document.getElementById('clock');
+  c.style.display = 'block';
+  (function tick() { c.textContent = Date.now() % 100000; requestAnimationFrame(tick); })();
+}
+connect();
+</script>
 </body>
 </html>
 )rawliteral";
@@ -66,12 +188,12 @@ void initCamera() {
     config.pin_pwdn = PWDN_GPIO_NUM;
     config.pin_reset = RESET_GPIO_NUM;
     config.xclk_freq_hz = 20000000;
-    config.frame_size = FRAMESIZE_VGA;
+    config.frame_size = CameraProfile::streamFrameSize;
     config.pixel_format = PIXFORMAT_JPEG;
     config.grab_mode = CAMERA_GRAB_WHEN_EMPTY;
     config.fb_location = CAMERA_FB_IN_PSRAM;
-    config.jpeg_quality = 10;
-    config.fb_count = 2;
+    config.jpeg_quality = CameraProfile::streamQuality;
+    config.fb_count = CameraProfile::streamFbCount;
 
     esp_err_t err = esp_camera_init(&config);
     if (err != ESP_OK) {
@@ -87,30 +209,170 @@ esp_err_t index_handler(httpd_req_t *req) {
 }
 
 esp_err_t stream_handler(httpd_req_t *req) {
-    camera_fb_t* fb = esp_camera_fb_get();
-    if (!fb) {
-        Serial.println("[CAMERA] Frame failed");
-        return ESP_FAIL;
-    }
-
     httpd_resp_set_type(req, "multipart/x-mixed-replace; boundary=frame");
-    
-    while (true) {
-        fb = esp_camera_fb_get();
-        if (!fb) break;
+
+    while (streaming) {
+        camera_fb_t* fb = esp_camera_fb_get();
+        if (!fb) {
+            Serial.println("[CAMERA] Frame failed");
+            return ESP_FAIL;
+        }
+        if (!powerAdmit()) {
+            esp_camera_fb_return(fb);
+            continue;
+        }
 
         char buf[128];
         snprintf(buf, sizeof(buf), "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n", fb->len);
-        httpd_resp_send_chunk(req, buf, strlen(buf));
-        httpd_resp_send_chunk(req, (const char*)fb->buf, fb->len);
-        httpd_resp_send_chunk(req, "\r\n", 2);
-        
+        esp_err_t err = httpd_resp_send_chunk(req, buf, strlen(buf));
+        if (err == ESP_OK) err = httpd_resp_send_chunk(req, (const char*)fb->buf, fb->len);
+        if (err == ESP_OK) err = httpd_resp_send_chunk(req, "\r\n", 2);
+
         esp_camera_fb_return(fb);
+        if (err != ESP_OK) break;  // Client went away
     }
-    
+
+    return ESP_OK;
+}
+
+esp_err_t view_handler(httpd_req_t *req) {
+    httpd_resp_send(req, VIEW_HTML, strlen(VIEW_HTML));
     return ESP_OK;
 }
 
+#if CONFIG_HTTPD_WS_SUPPORT
+// Handshake: this socket becomes the viewer. After that: acks.
+esp_err_t ws_handler(httpd_req_t *req) {
+    if (req->method == HTTP_GET) {
+        portENTER_CRITICAL(&wsMux);
+        wsFd = httpd_req_to_sockfd(req);
+        wsInFlight = 0;
+        portEXIT_CRITICAL(&wsMux);
+        Serial.println("[WS] Viewer connected");
+        xTaskNotifyGive(wsTaskHandle);
+        return ESP_OK;
+    }
+
+    uint8_t buf[WS_HEADER_SIZE];
+    httpd_ws_frame_t frame = {};
+    frame.payload = buf;
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, sizeof(buf));
+    if (err != ESP_OK) return err;
+    if (frame.type != HTTPD_WS_TYPE_BINARY || frame.len != WS_HEADER_SIZE) return ESP_OK;
+
+    uint32_t seq = buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t)buf[3] << 24;
+    int64_t captured = 0;
+    portENTER_CRITICAL(&wsMux);
+    for (uint8_t i = 0; i < wsInFlight; i++) {
+        if (wsSentSeq[i] != seq) continue;
+        captured = wsCaptureUs[i];
+        wsSentSeq[i] = wsSentSeq[wsInFlight - 1];
+        wsCaptureUs[i] = wsCaptureUs[wsInFlight - 1];
+        wsInFlight--;
+        break;
+    }
+    portEXIT_CRITICAL(&wsMux);
+    if (!captured) return ESP_OK;  // Late ack for a frame already given up on
+
+    // fb->timestamp is esp_timer time, not the wall clock SNTP adjusts
+    uint32_t latency = esp_timer_get_time() - captured;
+    wsLatencySumUs += latency;
+    if (latency > wsLatencyMaxUs) wsLatencyMaxUs = latency;
+    wsAcks++;
+    wsLastAck = millis();
+    xTaskNotifyGive(wsTaskHandle);
+    return ESP_OK;
+}
+
+// Sends one JPEG as a fragmented message - header, then the frame buffer
+// itself - so it is never copied
+esp_err_t wsSendFrame(int fd, uint32_t seq, camera_fb_t* fb) {
+    uint8_t header[WS_HEADER_SIZE] = { (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16),
+                                       (uint8_t)(seq >> 24) };
+    httpd_ws_frame_t frame = {};
+    frame.type = HTTPD_WS_TYPE_BINARY;
+    frame.fragmented = true;
+    frame.final = false;
+    frame.payload = header;
+    frame.len = sizeof(header);
+    esp_err_t err = httpd_ws_send_frame_async(server, fd, &frame);
+    if (err != ESP_OK) return err;
+    frame.type = HTTPD_WS_TYPE_CONTINUE;
+    frame.final = true;
+    frame.payload = fb->buf;
+    frame.len = fb->len;
+    return httpd_ws_send_frame_async(server, fd, &frame);
+}
+
+// Sends a frame whenever the viewer has a free in-flight slot. Runs on
+// core 1 beside the camera driver, not in the server task that handles acks.
+void wsTask(void* arg) {
+    while (streaming) {
+        portENTER_CRITICAL(&wsMux);
+        int fd = wsFd;
+        uint8_t inFlight = wsInFlight;
+        portEXIT_CRITICAL(&wsMux);
+
+        if (fd < 0 || inFlight >= WS_MAX_IN_FLIGHT) {
+            if (fd >= 0) wsStalls++;
+            if (!ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WS_ACK_TIMEOUT_MS)) && fd >= 0 &&
+                millis() - wsLastAck >= WS_ACK_TIMEOUT_MS) {
+                portENTER_CRITICAL(&wsMux);
+                wsInFlight = 0;
+                portEXIT_CRITICAL(&wsMux);
+            }
+            continue;
+        }
+
+        camera_fb_t* fb = esp_camera_fb_get();
+        if (!fb) {
+            Serial.println("[CAMERA] Frame failed");
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (!powerAdmit()) {
+            esp_camera_fb_return(fb);
+            continue;
+        }
+        uint32_t seq = ++wsSeq;
+        portENTER_CRITICAL(&wsMux);
+        wsSentSeq[wsInFlight] = seq;
+        wsCaptureUs[wsInFlight] = fb->timestamp.tv_sec * 1000000LL + fb->timestamp.tv_usec;
+        wsInFlight++;
+        portEXIT_CRITICAL(&wsMux);
+        if (inFlight == 0) wsLastAck = millis();  // Ack timeout counts from here
+
+        esp_err_t err = ESP_FAIL;
+        if (httpd_ws_get_fd_info(server, fd) == HTTPD_WS_CLIENT_WEBSOCKET) err = wsSendFrame(fd, seq, fb);
+        if (err == ESP_OK) {
+            wsFrames++;
+            wsBytes += fb->len;
+        }
+        esp_camera_fb_return(fb);
+        if (err != ESP_OK) {
+            // Viewer gone - wait for the next handshake
+            portENTER_CRITICAL(&wsMux);
+            if (wsFd == fd) wsFd = -1;
+            wsInFlight = 0;
+            portEXIT_CRITICAL(&wsMux);
+            Serial.println("[WS] Viewer disconnected");
+        }
+    }
+    xSemaphoreGive(wsDone);
+    vTaskDelete(nullptr);
+}
+
+void wsStatus(uint32_t now) {
+    if (wsFd < 0 && !wsFrames) return;
+    uint32_t interval = STATUS_INTERVAL / 1000;
+    Serial.printf("[WS] %lu fps | %lu KB/s | Capture to ack avg %lu max %lu ms | Stalls %lu\n",
+                  wsFrames / interval, wsBytes / 1024 / interval,
+                  wsAcks ? (uint32_t)(wsLatencySumUs / wsAcks / 1000) : 0, wsLatencyMaxUs / 1000, wsStalls);
+    wsFrames = wsBytes = wsStalls = wsAcks = wsLatencyMaxUs = 0;
+    wsLatencySumUs = 0;
+}
+#endif
+
 void startWebServer() {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
@@ -129,35 +391,95 @@ void startWebServer() {
         .user_ctx = NULL
     };
 
-    httpd_handle_t server = NULL;
+    httpd_uri_t view_uri = {
+        .uri = "/view",
+        .method = HTTP_GET,
+        .handler = view_handler,
+        .user_ctx = NULL
+    };
+
+    streaming = true;
     if (httpd_start(&server, &config) == ESP_OK) {
         httpd_register_uri_handler(server, &index_uri);
         httpd_register_uri_handler(server, &stream_uri);
+        httpd_register_uri_handler(server, &view_uri);
+#if CONFIG_HTTPD_WS_SUPPORT
+        httpd_uri_t ws_uri = {
+            .uri = "/ws",
+            .method = HTTP_GET,
+            .handler = ws_handler,
+            .user_ctx = NULL,
+            .is_websocket = true
+        };
+        wsFd = -1;
+        wsDone = xSemaphoreCreateBinary();
+        xTaskCreatePinnedToCore(wsTask, "ws", WS_STACK, nullptr, 1, &wsTaskHandle, 1);
+        httpd_register_uri_handler(server, &ws_uri);
+        schedEvery("status", STATUS_INTERVAL, wsStatus);
+#else
+        Serial.println("[SERVER] No WebSocket support - /ws disabled");
+#endif
         Serial.println("[SERVER] Started");
     }
 }
 
 void setup() {
-    WRITE_PERI_REG(RTC_CNTL_BROWN_OUT_REG, 0);
+    powerWatchInit();
     pinMode(LED_PIN, OUTPUT);
     digitalWrite(LED_PIN, HIGH);
 
     Serial.begin(115200);
-    delay(1000);
     Serial.println("\n[STREAM] Starting...");
-    Serial.flush();
 
-    initCamera();
+    // Camera init overlaps the AP coming up
+    BootTask camera;
+    bootStart(&camera, "camera", initCamera, 1);
 
+    int p = bootPhaseBegin("wifi");
     WiFi.softAP("ESP-Kit", "12345678");
+    bootPhaseEnd(p);
+
+    bootWait(&camera);
     Serial.println("[WiFi] AP: ESP-Kit");
     Serial.println("[WiFi] Pass: 12345678");
     Serial.print("[WiFi] IP: ");
     Serial.println(WiFi.softAPIP());
 
+    p = bootPhaseBegin("server");
     startWebServer();
+    bootPhaseEnd(p);
+
+    bootProfilePrint();
+    powerWatchBegin("frames");
+    schedEvery("power", POWER_SAMPLE_MS, powerWatchTick);
 }
 
+// The HTTP server and the WebSocket sender run their own tasks; the loop
+// task only wakes for the status line
 void loop() {
-    delay(1000);
+    schedRun();
+}
+
+// Stops the server and camera and drops the AP, for mode switching
+void teardown() {
+    schedStop();
+    streaming = false;
+#if CONFIG_HTTPD_WS_SUPPORT
+    if (wsDone) {
+        xTaskNotifyGive(wsTaskHandle);
+        xSemaphoreTake(wsDone, portMAX_DELAY);
+        vSemaphoreDelete(wsDone);
+        wsDone = nullptr;
+        wsTaskHandle = nullptr;
+    }
+#endif
+    if (server) {
+        httpd_stop(server);  // Waits for an open stream to see the flag
+        server = NULL;
+    }
+    esp_camera_deinit();
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_OFF);
 }
+
+MODULE_END
@@ -0,0 +1,64 @@
+// Motion event index validation, on the host: pio test -e native
+
+#include <string.h>
+#include <unity.h>
+
+#include "motion_index.h"
+
+static MotionEventRecord event() {
+    MotionEventRecord r;
+    memset(&r, 0, sizeof(r));
+    r.time = 1700000000;
+    r.uptimeMs = 123456;
+    r.firedCount = 3;
+    r.maxDelta = 42;
+    r.flags = MOTION_EVENT_CLOCK_SET;
+    strcpy(r.file, "2024-01-01/14/120000.avi");
+    motionIndexSeal(&r);
+    return r;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_sealed_record_is_valid() {
+    MotionEventRecord r = event();
+    TEST_ASSERT_TRUE(motionIndexValid(&r));
+}
+
+// Padding and the zero-filled tail FAT leaves after a power cut
+void test_zero_record_is_rejected() {
+    MotionEventRecord r;
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT_EQUAL_UINT16(r.check, motionIndexCheck(&r));
+    TEST_ASSERT_FALSE(motionIndexValid(&r));
+}
+
+void test_corrupt_record_is_rejected() {
+    MotionEventRecord r = event();
+    r.firedCount++;
+    TEST_ASSERT_FALSE(motionIndexValid(&r));
+}
+
+void test_unterminated_file_is_rejected() {
+    MotionEventRecord r = event();
+    memset(r.file, 'a', sizeof(r.file));
+    r.check = motionIndexCheck(&r);
+    TEST_ASSERT_FALSE(motionIndexValid(&r));
+}
+
+void test_pad_realigns_torn_tail() {
+    size_t base = MOTION_INDEX_HEADER_SIZE + 2 * sizeof(MotionEventRecord);
+    TEST_ASSERT_EQUAL_UINT32(0, motionIndexPad(base));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(MotionEventRecord) - 10, motionIndexPad(base + 10));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sealed_record_is_valid);
+    RUN_TEST(test_zero_record_is_rejected);
+    RUN_TEST(test_corrupt_record_is_rejected);
+    RUN_TEST(test_unterminated_file_is_rejected);
+    RUN_TEST(test_pad_realigns_torn_tail);
+    return UNITY_END();
+}
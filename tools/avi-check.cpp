@@ -0,0 +1,192 @@
+// Host-side check for the MJPEG AVI clips written by motion.cpp.
+//
+//   avi-check clip.avi [...]      validate clips pulled from the SD card
+//   avi-check --gen out.avi N     write an N-frame clip with avi_writer.h
+//
+// Validation walks the RIFF structure, checks every movi chunk is a complete
+// JPEG whose SOF matches the stream size, checks idx1 against the chunks, then
+// seeks to every indexed frame in shuffled order and checks it lands on a JPEG.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/avi-check.cpp -o avi-check
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "avi_writer.h"
+
+struct HostFile {
+    FILE* f;
+    size_t write(const uint8_t* data, size_t len) { return fwrite(data, 1, len, f); }
+    bool seek(uint32_t pos) { return fseek(f, pos, SEEK_SET) == 0; }
+    void flush() { fflush(f); }
+};
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool tagIs(const uint8_t* p, const char* tag) {
+    return memcmp(p, tag, 4) == 0;
+}
+
+// Finds SOF0/SOF2 and returns the frame size. Also requires SOI/EOI.
+static bool jpegSize(const uint8_t* p, size_t len, uint16_t* w, uint16_t* h) {
+    if (len < 4 || p[0] != 0xFF || p[1] != 0xD8) return false;
+    size_t end = len;
+    while (end > 2 && p[end - 1] == 0) end--;  // Camera pads with zeros
+    if (p[end - 2] != 0xFF || p[end - 1] != 0xD9) return false;
+
+    size_t pos = 2;
+    while (pos + 9 < len) {
+        if (p[pos] != 0xFF) return false;
+        uint8_t marker = p[pos + 1];
+        uint16_t segLen = (p[pos + 2] << 8) | p[pos + 3];
+        if (marker == 0xC0 || marker == 0xC2) {
+            *h = (p[pos + 5] << 8) | p[pos + 6];
+            *w = (p[pos + 7] << 8) | p[pos + 8];
+            return true;
+        }
+        pos += 2 + segLen;
+    }
+    return false;
+}
+
+static int fail(const char* path, const char* msg) {
+    printf("%s: FAIL - %s\n", path, msg);
+    return 1;
+}
+
+static int checkAvi(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return fail(path, "cannot open");
+    std::vector<uint8_t> data;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) data.insert(data.end(), chunk, chunk + n);
+    fclose(f);
+
+    const uint8_t* d = data.data();
+    size_t size = data.size();
+    if (size < AVI_HEADER_SIZE || !tagIs(d, "RIFF") || !tagIs(d + 8, "AVI ")) {
+        return fail(path, "not a RIFF AVI");
+    }
+    if (get32(d + 4) != size - 8) return fail(path, "RIFF size does not match file size");
+    if (!tagIs(d + 24, "avih") || !tagIs(d + 108, "vids") || !tagIs(d + 112, "MJPG")) {
+        return fail(path, "unexpected header layout");
+    }
+    if (!tagIs(d + 212, "LIST") || !tagIs(d + AVI_MOVI_OFFSET, "movi")) return fail(path, "movi list missing");
+
+    uint32_t usPerFrame = get32(d + 32);
+    uint32_t totalFrames = get32(d + 48);
+    uint32_t width = get32(d + 64);
+    uint32_t height = get32(d + 68);
+    uint32_t moviEnd = 220 + get32(d + 216);
+    if (moviEnd > size) return fail(path, "movi list overruns file");
+    if (get32(d + 140) != totalFrames) return fail(path, "strh length differs from avih frames");
+
+    // Walk the chunks in order, as a player without an index would
+    std::vector<AviIndexEntry> chunks;
+    uint32_t pos = AVI_HEADER_SIZE;
+    while (pos + 8 <= moviEnd) {
+        if (!tagIs(d + pos, "00dc")) return fail(path, "unexpected chunk in movi");
+        uint32_t len = get32(d + pos + 4);
+        if (pos + 8 + len > moviEnd) return fail(path, "frame chunk overruns movi");
+        uint16_t w, h;
+        if (!jpegSize(d + pos + 8, len, &w, &h)) return fail(path, "frame is not a complete JPEG");
+        if (w != width || h != height) return fail(path, "frame size differs from header");
+        chunks.push_back({ pos - AVI_MOVI_OFFSET, len });
+        pos += 8 + len + (len & 1);
+    }
+    if (pos != moviEnd) return fail(path, "trailing bytes in movi");
+    if (chunks.size() != totalFrames) return fail(path, "header frame count differs from movi");
+
+    if (moviEnd + 8 > size || !tagIs(d + moviEnd, "idx1")) return fail(path, "idx1 missing");
+    uint32_t idxLen = get32(d + moviEnd + 4);
+    if (idxLen != chunks.size() * 16 || moviEnd + 8 + idxLen != size) return fail(path, "idx1 size wrong");
+
+    const uint8_t* idx = d + moviEnd + 8;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        const uint8_t* e = idx + i * 16;
+        if (!tagIs(e, "00dc") || !(get32(e + 4) & AVI_IDX1_KEYFRAME)) return fail(path, "bad idx1 entry");
+        if (get32(e + 8) != chunks[i].offset || get32(e + 12) != chunks[i].size) {
+            return fail(path, "idx1 entry does not match chunk");
+        }
+    }
+
+    // Seek test: jump straight to each indexed frame in shuffled order
+    std::vector<uint32_t> order(chunks.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    srand(order.size());
+    for (size_t i = order.size(); i > 1; i--) {
+        size_t j = rand() % i;
+        uint32_t t = order[i - 1]; order[i - 1] = order[j]; order[j] = t;
+    }
+    for (uint32_t i : order) {
+        const uint8_t* e = idx + i * 16;
+        uint32_t at = AVI_MOVI_OFFSET + get32(e + 8);
+        uint16_t w, h;
+        if (!tagIs(d + at, "00dc") || get32(d + at + 4) != get32(e + 12) ||
+            !jpegSize(d + at + 8, get32(e + 12), &w, &h)) {
+            return fail(path, "seek via idx1 did not land on a frame");
+        }
+    }
+
+    double fps = usPerFrame ? 1000000.0 / usPerFrame : 0;
+    printf("%s: OK - %u frames, %ux%u, %.2f fps, %.1fs\n", path, totalFrames, width, height,
+           fps, fps > 0 ? totalFrames / fps : 0);
+    return 0;
+}
+
+// Minimal baseline JPEG: valid markers and a 16x16 SOF, enough for the checker
+static size_t fakeJpeg(uint8_t* out, uint16_t w, uint16_t h, uint32_t seq) {
+    static const uint8_t head[] = { 0xFF, 0xD8, 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0,
+                                    1, 1, 0, 0, 1, 0, 1, 0, 0 };
+    size_t n = 0;
+    memcpy(out, head, sizeof(head));
+    n += sizeof(head);
+    uint8_t sof[] = { 0xFF, 0xC0, 0x00, 0x0B, 8, (uint8_t)(h >> 8), (uint8_t)h,
+                      (uint8_t)(w >> 8), (uint8_t)w, 1, 1, 0x11, 0 };
+    memcpy(out + n, sof, sizeof(sof));
+    n += sizeof(sof);
+    size_t body = 1000 + (seq * 7919) % 20000;  // Vary sizes, odd and even
+    memset(out + n, 0x55, body);
+    n += body;
+    out[n++] = 0xFF;
+    out[n++] = 0xD9;
+    return n;
+}
+
+static int generate(const char* path, uint32_t frames) {
+    HostFile hf = { fopen(path, "wb") };
+    if (!hf.f) return fail(path, "cannot create");
+
+    static AviWriter<HostFile> writer;
+    static uint8_t buf[32768];
+    static uint8_t jpeg[32768];
+    aviOpen(&writer, &hf, buf, sizeof(buf), 800, 600);
+    uint32_t added = 0;
+    for (uint32_t i = 0; i < frames; i++) {
+        size_t len = fakeJpeg(jpeg, 800, 600, i);
+        if (aviAddFrame(&writer, jpeg, len, i * 100)) added++;
+    }
+    bool ok = aviClose(&writer);
+    fclose(hf.f);
+    printf("%s: wrote %u frames%s\n", path, added, ok ? "" : " (write error)");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "--gen") == 0) {
+        return generate(argv[2], strtoul(argv[3], nullptr, 10));
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s clip.avi [...] | --gen out.avi frames\n", argv[0]);
+        return 2;
+    }
+    int failed = 0;
+    for (int i = 1; i < argc; i++) failed += checkAvi(argv[i]);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,196 @@
+// Lists client activity records written by the sniffer ("clients=" in
+// node.cfg).
+//
+//   client-dump /mnt/sdcard/clients/<stamp>.cli            BSS records, CSV
+//   client-dump --site /mnt/sdcard/clients/<stamp>.cli     site records, CSV
+//   client-dump --summary /mnt/sdcard/clients/*.cli        per-BSSID totals
+//
+// BSS columns: time (UTC, or +seconds since boot when the clock was unset),
+// bssid, channel, interval_s, stations, frames, data_frames, data_kb,
+// up_pct (uplink share of data bytes), retry_pct (of data frames),
+// rssi_mean. Site columns: time, interval_s, frames, data_frames,
+// probe_requests, bssids, stations, associated, probing, probing_random.
+// A "+" after a count means that interval's table was full, so the count
+// is a lower bound. Torn or corrupt records are skipped and counted on
+// stderr.
+//
+// The summary sorts BSSIDs by data bytes and shows the mean and peak
+// stations per interval, which is the number to plan capacity on.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/client-dump.cpp -o client-dump
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "client_stats.h"
+
+enum Mode { MODE_BSS, MODE_SITE, MODE_SUMMARY };
+
+struct BssTotal {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t records;
+    uint64_t stations;
+    uint32_t maxStations;
+    uint64_t frames;
+    uint64_t dataFrames;
+    uint64_t dataBytes;
+    uint64_t upBytes;
+    uint64_t dataRetries;
+};
+
+struct SiteTotal {
+    uint32_t records;
+    uint32_t maxStations;
+    uint32_t maxAssociated;
+    uint32_t maxBssids;
+    uint64_t probeRequests;
+    bool saturated;
+};
+
+static void formatTime(char* buf, size_t size, uint32_t time, uint32_t uptimeS, uint8_t flags) {
+    if (flags & CLIENT_CLOCK_SET) {
+        time_t t = time;
+        strftime(buf, size, "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+    } else {
+        snprintf(buf, size, "+%u", uptimeS);
+    }
+}
+
+static double pct(uint64_t part, uint64_t whole) {
+    return whole ? part * 100.0 / whole : 0;
+}
+
+static void printBss(const ClientBssRecord& r) {
+    char when[32];
+    formatTime(when, sizeof(when), r.time, r.uptimeS, r.flags);
+    const uint8_t* b = r.bssid;
+    printf("%s,%02X:%02X:%02X:%02X:%02X:%02X,%u,%u,%u%s,%u,%u,%.1f,%.1f,%.1f,%d\n", when, b[0], b[1], b[2],
+           b[3], b[4], b[5], r.channel, r.intervalS, r.stations,
+           r.flags & CLIENT_STA_SATURATED ? "+" : "", r.frames, r.dataFrames, r.dataBytes / 1024.0,
+           pct(r.upBytes, r.dataBytes), pct(r.dataRetries, r.dataFrames), r.rssiMean);
+}
+
+static void printSite(const ClientSiteRecord& r) {
+    char when[32];
+    formatTime(when, sizeof(when), r.time, r.uptimeS, r.flags);
+    const char* staFull = r.flags & CLIENT_STA_SATURATED ? "+" : "";
+    printf("%s,%u,%u,%u,%u,%u%s,%u%s,%u,%u,%u\n", when, r.intervalS, r.frames, r.dataFrames,
+           r.probeRequests, r.bssids, r.flags & CLIENT_BSS_SATURATED ? "+" : "", r.stations, staFull,
+           r.associated, r.probing, r.probingRandom);
+}
+
+static uint64_t bssKey(const uint8_t* mac) {
+    uint64_t k = 0;
+    for (int i = 0; i < 6; i++) k = k << 8 | mac[i];
+    return k;
+}
+
+static bool readClients(const char* path, Mode mode, std::map<uint64_t, BssTotal>& bss, SiteTotal& site) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    ClientHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || !clientHeaderValid(&header)) {
+        fprintf(stderr, "%s: not a client activity file\n", path);
+        fclose(f);
+        return false;
+    }
+
+    ClientRecord r;
+    uint32_t good = 0, bad = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (!clientValid(&r)) {
+            bad++;
+            continue;
+        }
+        good++;
+        bool isSite = r.site.kind == CLIENT_KIND_SITE;
+        if (mode == MODE_BSS) {
+            if (!isSite) printBss(r.bss);
+            continue;
+        }
+        if (mode == MODE_SITE) {
+            if (isSite) printSite(r.site);
+            continue;
+        }
+        if (isSite) {
+            site.records++;
+            site.maxStations = std::max<uint32_t>(site.maxStations, r.site.stations);
+            site.maxAssociated = std::max<uint32_t>(site.maxAssociated, r.site.associated);
+            site.maxBssids = std::max<uint32_t>(site.maxBssids, r.site.bssids);
+            site.probeRequests += r.site.probeRequests;
+            if (r.site.flags & (CLIENT_BSS_SATURATED | CLIENT_STA_SATURATED)) site.saturated = true;
+            continue;
+        }
+        BssTotal& t = bss[bssKey(r.bss.bssid)];
+        memcpy(t.bssid, r.bss.bssid, 6);
+        t.channel = r.bss.channel;
+        t.records++;
+        t.stations += r.bss.stations;
+        t.maxStations = std::max<uint32_t>(t.maxStations, r.bss.stations);
+        t.frames += r.bss.frames;
+        t.dataFrames += r.bss.dataFrames;
+        t.dataBytes += r.bss.dataBytes;
+        t.upBytes += r.bss.upBytes;
+        t.dataRetries += r.bss.dataRetries;
+    }
+    fclose(f);
+    fprintf(stderr, "%s: %u records\n", path, good);
+    if (bad) fprintf(stderr, "%s: %u torn or corrupt records skipped\n", path, bad);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Mode mode = MODE_BSS;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--site") == 0) {
+        mode = MODE_SITE;
+        first = 2;
+    } else if (argc > 1 && strcmp(argv[1], "--summary") == 0) {
+        mode = MODE_SUMMARY;
+        first = 2;
+    }
+    if (argc <= first) {
+        fprintf(stderr, "usage: %s [--site | --summary] clients.cli [...]\n", argv[0]);
+        return 2;
+    }
+
+    if (mode == MODE_BSS) {
+        printf("time,bssid,channel,interval_s,stations,frames,data_frames,data_kb,up_pct,retry_pct,rssi_mean\n");
+    } else if (mode == MODE_SITE) {
+        printf("time,interval_s,frames,data_frames,probe_requests,bssids,stations,associated,probing,"
+               "probing_random\n");
+    }
+    std::map<uint64_t, BssTotal> bss;
+    SiteTotal site = {};
+    int failed = 0;
+    for (int i = first; i < argc; i++) failed += !readClients(argv[i], mode, bss, site);
+
+    if (mode == MODE_SUMMARY) {
+        std::vector<BssTotal> sorted;
+        for (const auto& kv : bss) sorted.push_back(kv.second);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const BssTotal& a, const BssTotal& b) { return a.dataBytes > b.dataBytes; });
+        printf("%-17s %3s %8s %9s %8s %12s %10s %6s %7s\n", "BSSID", "CH", "records", "sta avg",
+               "sta max", "data frames", "data MB", "up%", "retry%");
+        for (const BssTotal& t : sorted) {
+            const uint8_t* b = t.bssid;
+            printf("%02X:%02X:%02X:%02X:%02X:%02X %3u %8u %9.1f %8u %12llu %10.1f %6.1f %7.1f\n", b[0], b[1],
+                   b[2], b[3], b[4], b[5], t.channel, t.records, t.records ? (double)t.stations / t.records : 0,
+                   t.maxStations, (unsigned long long)t.dataFrames, t.dataBytes / 1048576.0,
+                   pct(t.upBytes, t.dataBytes), pct(t.dataRetries, t.dataFrames));
+        }
+        printf("\n%u intervals | peak %u BSSIDs, %u stations (%u associated) | %llu probe requests%s\n",
+               site.records, site.maxBssids, site.maxStations, site.maxAssociated,
+               (unsigned long long)site.probeRequests, site.saturated ? " | tables were full at times" : "");
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,420 @@
+// Host-side accuracy / cost harness for the block-grid motion detector.
+//
+//   motion-bench [--threshold N] [--min-blocks N] [--mask mask.txt] [--scale 4|8] corpus/
+//   motion-bench --synth corpus/
+//
+// A corpus is a directory of sequences. Each sequence is a directory of JPEG
+// frames plus labels.txt with one "<file> <0|1>" line per frame, in playback
+// order (1 = motion in that frame). The sequence name prefix picks the
+// category: motion-*, still-* or light-* (lighting change, no motion).
+// Real sequences can be made from device clips, e.g.
+//   ffmpeg -i clip.avi corpus/motion-door/%03d.jpg
+//
+// Frames go through the same path as motion.cpp: a 1/8 scale luma thumbnail
+// (libjpeg DCT scaling here, tjpgd on the device) fed to motion_grid.h.
+// --scale 4 decodes at 1/4, as dual mode does with its detect frames.
+// Reports precision/recall per sequence and category, ms/frame for decode and
+// detect, and heap bytes allocated per frame in each stage.
+//
+// --synth writes a small generated corpus (textured scene with sensor noise,
+// moving objects, lighting steps and ramps) so the harness runs without any
+// recordings.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/motion-bench.cpp -ljpeg -o motion-bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <jpeglib.h>
+
+#include "motion_grid.h"
+
+#define THUMB_MAX_W 200
+#define THUMB_MAX_H 150
+
+// Heap accounting (glibc): count malloc traffic while a stage is measured
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+
+static bool trackAllocs = false;
+static uint64_t allocBytes = 0;
+static uint64_t allocCalls = 0;
+
+extern "C" void* malloc(size_t n) {
+    if (trackAllocs) { allocBytes += n; allocCalls++; }
+    return __libc_malloc(n);
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+    if (trackAllocs) { allocBytes += n * size; allocCalls++; }
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t n) {
+    if (trackAllocs) { allocBytes += n; allocCalls++; }
+    return __libc_realloc(p, n);
+}
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct JpegError {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr cinfo) {
+    longjmp(((JpegError*)cinfo->err)->jump, 1);
+}
+
+static bool readFile(const std::string& path, std::vector<uint8_t>* out) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out->resize(size);
+    bool ok = fread(out->data(), 1, size, f) == (size_t)size;
+    fclose(f);
+    return ok;
+}
+
+// Same thumbnail as the device: 1/scale, luma only
+static bool decodeThumb(const std::vector<uint8_t>& jpeg, uint8_t scale, uint8_t* thumb, uint16_t* w,
+                        uint16_t* h) {
+    jpeg_decompress_struct cinfo;
+    JpegError err;
+    cinfo.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit = jpegErrorExit;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char*)jpeg.data(), jpeg.size());
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale;
+    cinfo.out_color_space = JCS_GRAYSCALE;
+    jpeg_start_decompress(&cinfo);
+
+    if (cinfo.output_width > THUMB_MAX_W || cinfo.output_height > THUMB_MAX_H) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+    *w = cinfo.output_width;
+    *h = cinfo.output_height;
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = thumb + cinfo.output_scanline * cinfo.output_width;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return true;
+}
+
+struct Score {
+    uint32_t tp, fp, fn, tn;
+};
+
+static void addScore(Score* a, const Score& b) {
+    a->tp += b.tp; a->fp += b.fp; a->fn += b.fn; a->tn += b.tn;
+}
+
+static double ratio(uint32_t num, uint32_t den) {
+    return den ? (double)num / den : 1.0;
+}
+
+static void printScore(const char* name, const Score& s) {
+    printf("%-24s %6u %5u %5u %5u %5u %9.3f %7.3f\n", name, s.tp + s.fp + s.fn + s.tn,
+           s.tp, s.fp, s.fn, s.tn, ratio(s.tp, s.tp + s.fp), ratio(s.tp, s.tp + s.fn));
+}
+
+struct Options {
+    uint8_t threshold = MOTION_THRESHOLD;
+    uint16_t minBlocks = MOTION_MIN_BLOCKS;
+    uint8_t scale = 8;
+    std::string mask;
+};
+
+struct Cost {
+    uint32_t frames = 0;
+    double decodeMs = 0, decodeMax = 0;
+    double detectMs = 0, detectMax = 0;
+    uint64_t decodeBytes = 0, detectBytes = 0;
+    uint64_t detectCalls = 0;
+};
+
+static std::vector<std::string> listDirs(const std::string& root) {
+    std::vector<std::string> dirs;
+    DIR* d = opendir(root.c_str());
+    if (!d) return dirs;
+    while (dirent* e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        struct stat st;
+        if (stat((root + "/" + e->d_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            dirs.push_back(e->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(dirs.begin(), dirs.end());
+    return dirs;
+}
+
+static bool runSequence(const std::string& dir, const Options& opt, MotionGrid* grid,
+                        uint8_t* thumb, Score* score, Cost* cost) {
+    FILE* labels = fopen((dir + "/labels.txt").c_str(), "r");
+    if (!labels) {
+        fprintf(stderr, "%s: no labels.txt\n", dir.c_str());
+        return false;
+    }
+
+    motionGridInit(grid, opt.threshold);
+    if (!opt.mask.empty()) {
+        std::vector<uint8_t> text;
+        if (readFile(opt.mask, &text)) {
+            motionGridLoadMask(grid, (const char*)text.data(), text.size(), opt.threshold);
+        }
+    }
+
+    char name[256];
+    int label;
+    std::vector<uint8_t> jpeg;
+    *score = Score();
+    while (fscanf(labels, "%255s %d", name, &label) == 2) {
+        if (!readFile(dir + "/" + name, &jpeg)) {
+            fprintf(stderr, "%s/%s: unreadable\n", dir.c_str(), name);
+            continue;
+        }
+
+        uint16_t w, h;
+        allocBytes = 0;
+        trackAllocs = true;
+        Clock::time_point t0 = Clock::now();
+        bool decoded = decodeThumb(jpeg, opt.scale, thumb, &w, &h);
+        double decodeMs = msSince(t0);
+        trackAllocs = false;
+        uint64_t decodeBytes = allocBytes;
+        if (!decoded) {
+            fprintf(stderr, "%s/%s: decode failed\n", dir.c_str(), name);
+            continue;
+        }
+
+        bool primed = grid->primed;
+        allocBytes = 0;
+        allocCalls = 0;
+        trackAllocs = true;
+        t0 = Clock::now();
+        uint16_t fired = motionGridFeed(grid, thumb, w, h);
+        double detectMs = msSince(t0);
+        trackAllocs = false;
+
+        cost->frames++;
+        cost->decodeMs += decodeMs;
+        cost->decodeMax = std::max(cost->decodeMax, decodeMs);
+        cost->decodeBytes += decodeBytes;
+        cost->detectMs += detectMs;
+        cost->detectMax = std::max(cost->detectMax, detectMs);
+        cost->detectBytes += allocBytes;
+        cost->detectCalls += allocCalls;
+
+        if (!primed) continue;  // Priming frame is not scored
+        bool predicted = fired >= opt.minBlocks;
+        if (predicted && label) score->tp++;
+        else if (predicted) score->fp++;
+        else if (label) score->fn++;
+        else score->tn++;
+    }
+    fclose(labels);
+    return true;
+}
+
+static int bench(const std::string& root, const Options& opt) {
+    std::vector<std::string> seqs = listDirs(root);
+    if (seqs.empty()) {
+        fprintf(stderr, "%s: no sequences\n", root.c_str());
+        return 1;
+    }
+
+    static MotionGrid grid;
+    static uint8_t thumb[THUMB_MAX_W * THUMB_MAX_H];
+    const char* categories[] = { "motion", "still", "light" };
+    Score byCategory[3] = {};
+    Score total = {};
+    Cost cost;
+
+    printf("threshold %u, min blocks %u, grid %dx%d, scale 1/%u%s%s\n\n", opt.threshold, opt.minBlocks,
+           MOTION_GRID_COLS, MOTION_GRID_ROWS, opt.scale, opt.mask.empty() ? "" : ", mask ", opt.mask.c_str());
+    printf("%-24s %6s %5s %5s %5s %5s %9s %7s\n", "sequence", "frames", "TP", "FP", "FN", "TN",
+           "precision", "recall");
+
+    for (const std::string& seq : seqs) {
+        Score s;
+        if (!runSequence(root + "/" + seq, opt, &grid, thumb, &s, &cost)) continue;
+        printScore(seq.c_str(), s);
+        addScore(&total, s);
+        for (int c = 0; c < 3; c++) {
+            if (seq.compare(0, strlen(categories[c]), categories[c]) == 0) addScore(&byCategory[c], s);
+        }
+    }
+
+    printf("\n");
+    for (int c = 0; c < 3; c++) {
+        std::string name = std::string("[") + categories[c] + "]";
+        printScore(name.c_str(), byCategory[c]);
+    }
+    printScore("[all]", total);
+
+    uint32_t n = cost.frames ? cost.frames : 1;
+    printf("\ndecode: %.3f ms/frame (max %.3f) | %llu bytes/frame allocated\n",
+           cost.decodeMs / n, cost.decodeMax, (unsigned long long)(cost.decodeBytes / n));
+    printf("detect: %.4f ms/frame (max %.4f) | %llu bytes/frame allocated (%llu calls total)\n",
+           cost.detectMs / n, cost.detectMax, (unsigned long long)(cost.detectBytes / n),
+           (unsigned long long)cost.detectCalls);
+    printf("state:  %zu bytes MotionGrid + %d bytes thumbnail (static)\n",
+           sizeof(MotionGrid), THUMB_MAX_W * THUMB_MAX_H);
+    return 0;
+}
+
+// --- Synthetic corpus --------------------------------------------------------
+
+#define SYNTH_W 320
+#define SYNTH_H 240
+#define SYNTH_FRAMES 60
+
+struct SynthObject {
+    int x0, y0, dx, dy, w, h;
+    uint8_t luma;
+    int start, end;  // Frames the object is moving in
+};
+
+struct SynthSequence {
+    const char* name;
+    SynthObject object;
+    int lightFrom, lightTo, lightDelta;  // Linear ramp; from == to is a step
+};
+
+static const SynthSequence SYNTH[] = {
+    { "still-noise", { 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 0, 0, 0 },
+    { "light-step-up", { 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 30, 30, 50 },
+    { "light-step-down", { 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 30, 30, -60 },
+    { "light-ramp", { 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 10, 50, 40 },
+    { "motion-walk", { 0, 80, 9, 0, 40, 80, 210, 15, 45 }, 0, 0, 0 },
+    { "motion-small", { 40, 40, 6, 4, 16, 16, 30, 20, 40 }, 0, 0, 0 },
+    { "motion-light", { 300, 120, -9, 0, 40, 80, 220, 15, 45 }, 25, 25, 40 },
+};
+
+static uint32_t lcg(uint32_t* state) {
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 16;
+}
+
+static bool writeJpeg(const std::string& path, const uint8_t* gray) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr err;
+    cinfo.err = jpeg_std_error(&err);
+    jpeg_create_compress(&cinfo);
+    jpeg_stdio_dest(&cinfo, f);
+    cinfo.image_width = SYNTH_W;
+    cinfo.image_height = SYNTH_H;
+    cinfo.input_components = 1;
+    cinfo.in_color_space = JCS_GRAYSCALE;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 80, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < SYNTH_H) {
+        JSAMPROW row = (JSAMPROW)gray + cinfo.next_scanline * SYNTH_W;
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    fclose(f);
+    return true;
+}
+
+static int synth(const std::string& root) {
+    mkdir(root.c_str(), 0755);
+    static uint8_t frame[SYNTH_W * SYNTH_H];
+    uint32_t rng = 12345;
+
+    for (const SynthSequence& seq : SYNTH) {
+        std::string dir = root + "/" + seq.name;
+        mkdir(dir.c_str(), 0755);
+        FILE* labels = fopen((dir + "/labels.txt").c_str(), "w");
+        if (!labels) return 1;
+
+        for (int i = 0; i < SYNTH_FRAMES; i++) {
+            int light = 0;
+            if (seq.lightDelta && i >= seq.lightFrom) {
+                int span = seq.lightTo - seq.lightFrom;
+                light = (span <= 0 || i >= seq.lightTo) ? seq.lightDelta
+                                                         : seq.lightDelta * (i - seq.lightFrom) / span;
+            }
+
+            for (int y = 0; y < SYNTH_H; y++) {
+                for (int x = 0; x < SYNTH_W; x++) {
+                    int v = 60 + (((x / 20) + (y / 20)) & 1) * 70 + (x * 7 + y * 13) % 23;
+                    v += light + (int)(lcg(&rng) % 7) - 3;  // Sensor noise
+                    frame[y * SYNTH_W + x] = v < 0 ? 0 : v > 255 ? 255 : v;
+                }
+            }
+
+            const SynthObject& o = seq.object;
+            bool moving = o.w && i >= o.start && i < o.end;
+            if (o.w && i >= o.start) {
+                int t = std::min(i, o.end - 1) - o.start;
+                int ox = o.x0 + o.dx * t, oy = o.y0 + o.dy * t;
+                for (int y = std::max(oy, 0); y < std::min(oy + o.h, SYNTH_H); y++) {
+                    for (int x = std::max(ox, 0); x < std::min(ox + o.w, SYNTH_W); x++) {
+                        frame[y * SYNTH_W + x] = std::min(255, o.luma + light);
+                    }
+                }
+            }
+
+            char name[16];
+            snprintf(name, sizeof(name), "%03d.jpg", i);
+            if (!writeJpeg(dir + "/" + name, frame)) return 1;
+            fprintf(labels, "%s %d\n", name, moving ? 1 : 0);
+        }
+        fclose(labels);
+        printf("%s: %d frames\n", dir.c_str(), SYNTH_FRAMES);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    std::string root;
+    bool makeSynth = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--synth") == 0) makeSynth = true;
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) opt.threshold = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--min-blocks") == 0 && i + 1 < argc) opt.minBlocks = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mask") == 0 && i + 1 < argc) opt.mask = argv[++i];
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) opt.scale = atoi(argv[++i]) == 4 ? 4 : 8;
+        else root = argv[i];
+    }
+    if (root.empty()) {
+        fprintf(stderr, "usage: %s [--threshold N] [--min-blocks N] [--mask file] [--scale 4|8] corpus/\n"
+                        "       %s --synth corpus/\n", argv[0], argv[0]);
+        return 2;
+    }
+    return makeSynth ? synth(root) : bench(root, opt);
+}
@@ -0,0 +1,81 @@
+// Lists motion events from the index the motion firmware keeps on SD.
+//
+//   motion-events /mnt/sdcard/motion/events.idx            CSV to stdout
+//   motion-events --grid /mnt/sdcard/motion/events.idx     plus block grids
+//
+// Columns: time (UTC, or +seconds since boot when the clock was unset),
+// uptime_ms, file (relative to /motion), max_diff, blocks, fired (hex bitmap).
+// Torn or corrupt records are skipped and counted on stderr.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/motion-events.cpp -o motion-events
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "motion_index.h"
+
+int main(int argc, char** argv) {
+    bool grid = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--grid") == 0) grid = true;
+        else path = argv[i];
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [--grid] events.idx\n", argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    MotionIndexHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || !motionIndexHeaderValid(&header)) {
+        fprintf(stderr, "%s: not a motion event index\n", path);
+        fclose(f);
+        return 1;
+    }
+
+    printf("time,uptime_ms,file,max_diff,blocks,fired\n");
+    MotionEventRecord rec;
+    uint32_t good = 0, bad = 0;
+    while (fread(&rec, sizeof(rec), 1, f) == 1) {
+        if (!motionIndexValid(&rec)) {
+            bad++;
+            continue;
+        }
+        good++;
+
+        char when[32];
+        if (rec.flags & MOTION_EVENT_CLOCK_SET) {
+            time_t t = rec.time;
+            strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+        } else {
+            snprintf(when, sizeof(when), "+%u", rec.time);
+        }
+
+        printf("%s,%u,%s,%u,%u,", when, rec.uptimeMs, rec.file, rec.maxDelta, rec.firedCount);
+        for (size_t i = 0; i < sizeof(rec.fired); i++) printf("%02x", rec.fired[i]);
+        printf("\n");
+
+        if (grid) {
+            for (int r = 0; r < header.gridRows; r++) {
+                printf("#   ");
+                for (int c = 0; c < header.gridCols; c++) {
+                    int b = r * header.gridCols + c;
+                    putchar(rec.fired[b >> 3] & (1 << (b & 7)) ? '#' : '-');
+                }
+                printf("\n");
+            }
+        }
+    }
+    fclose(f);
+
+    fprintf(stderr, "%u events, %u skipped\n", good, bad);
+    return 0;
+}
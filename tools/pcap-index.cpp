@@ -0,0 +1,643 @@
+// Indexes and summarizes sniffer pcap captures without a Wireshark pass.
+//
+//   pcap-index [--threads N] [--all] capture.pcap [...]   summary
+//   pcap-index --bssid AA:BB:CC:DD:EE:FF -o out.pcap capture.pcap
+//   pcap-index --channel 6 -o out.pcap capture.pcap
+//   pcap-index --gen capture.pcap N                        reference capture
+//
+// The capture is mmapped and cut into one range per thread. Each cut is
+// moved forward to a record boundary: an offset where RESYNC_CHAIN record
+// headers in a row are plausible (pcap_scan.h rules). Threads then parse
+// their ranges in parallel; every thread must end exactly where the next one
+// starts, which proves the cuts were real boundaries - otherwise the file is
+// parsed again on one thread. A torn tail ends the last range, as in
+// pcap-repair.
+//
+// The result is cached in <capture>.idx (summary tables plus record offsets
+// grouped by BSSID), keyed on the capture's size and mtime. Later summaries
+// and --bssid / --channel slices read the index and copy the listed records
+// straight out of the map, with no rescan. --rebuild ignores a cached index.
+//
+// Channels come from the DS parameter IE of beacons / probe responses: the
+// capture (linktype 105) has no radiotap header, so a BSSID that was never
+// heard beaconing has channel "?". Control frames carry no BSSID and are
+// only counted by type.
+//
+// Build: g++ -O2 -std=c++11 -pthread -Iinclude tools/pcap-index.cpp -o pcap-index
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "pcap_scan.h"
+#include "dot11.h"
+
+#define RESYNC_CHAIN 8
+#define MIN_RANGE (1 << 20)  // Below this per thread, fewer threads
+#define TOP_BSSIDS 20
+#define IDX_MAGIC 0x58444950  // "PIDX"
+#define IDX_VERSION 1
+
+static const char* TYPE_NAMES[3] = { "mgmt", "ctrl", "data" };
+static const char* MGMT_NAMES[16] = {
+    "assoc-req", "assoc-resp", "reassoc-req", "reassoc-resp", "probe-req", "probe-resp",
+    "timing-adv", "mgmt-7", "beacon", "atim", "disassoc", "auth", "deauth", "action",
+    "action-noack", "mgmt-15",
+};
+
+struct Bss {
+    uint8_t mac[6];
+    uint8_t channel;
+    uint8_t ssidLen;
+    char ssid[32];
+    uint64_t frames;
+    uint64_t bytes;
+    uint32_t beacons;
+    uint32_t data;
+    std::vector<uint64_t> offsets;
+};
+
+// Summary of one capture (or of one thread's range, before merging)
+struct Summary {
+    std::unordered_map<uint64_t, Bss> bss;
+    uint64_t types[3][16];
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t retries;
+    uint64_t firstUs;
+    uint64_t lastUs;
+    size_t end;  // Offset after the last complete record
+};
+
+struct Capture {
+    const uint8_t* data;
+    size_t size;
+    uint32_t snaplen;
+    int64_t mtime;
+};
+
+struct IdxHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t pcapSize;
+    int64_t pcapMtime;
+    uint64_t valid;
+    uint64_t records;
+    uint64_t bytes;
+    uint64_t retries;
+    uint64_t firstUs;
+    uint64_t lastUs;
+    uint64_t types[3][16];
+    uint32_t bssCount;
+    uint32_t reserved;
+};
+
+struct IdxBss {
+    uint8_t mac[6];
+    uint8_t channel;
+    uint8_t ssidLen;
+    char ssid[32];
+    uint64_t frames;
+    uint64_t bytes;
+    uint32_t beacons;
+    uint32_t data;
+    uint64_t offsetCount;  // Offsets follow the BSSID table, in table order
+};
+
+static uint64_t macKey(const uint8_t* mac) {
+    uint64_t k = 0;
+    for (int i = 0; i < 6; i++) k |= (uint64_t)mac[i] << (8 * i);
+    return k;
+}
+
+static bool parseMac(const char* s, uint8_t* mac) {
+    unsigned b[6];
+    if (sscanf(s, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) return false;
+    for (int i = 0; i < 6; i++) mac[i] = b[i];
+    return true;
+}
+
+static double seconds(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Length of the record at pos, 0 if its header is implausible or it is cut off
+static size_t recordAt(const Capture& c, size_t pos) {
+    if (pos + PCAP_RECORD_HEADER_SIZE > c.size) return 0;
+    const uint8_t* h = c.data + pos;
+    uint32_t usec = pcapLe32(h + 4);
+    uint32_t incl = pcapLe32(h + 8);
+    uint32_t orig = pcapLe32(h + 12);
+    if (usec >= 1000000 || incl == 0 || incl > c.snaplen || incl > orig) return 0;
+    if (pos + PCAP_RECORD_HEADER_SIZE + incl > c.size) return 0;
+    return PCAP_RECORD_HEADER_SIZE + incl;
+}
+
+// First offset in [from, limit) that starts RESYNC_CHAIN plausible records
+// (or a shorter chain ending exactly at the end of the file)
+static size_t findBoundary(const Capture& c, size_t from, size_t limit) {
+    for (size_t p = from; p < limit; p++) {
+        size_t q = p;
+        int n = 0;
+        while (n < RESYNC_CHAIN) {
+            size_t len = recordAt(c, q);
+            if (!len) break;
+            q += len;
+            n++;
+        }
+        if (n == RESYNC_CHAIN || (n > 0 && q == c.size)) return p;
+    }
+    return limit;
+}
+
+static void resetSummary(Summary* s) {
+    s->bss.clear();
+    memset(s->types, 0, sizeof(s->types));
+    s->records = s->bytes = s->retries = 0;
+    s->firstUs = UINT64_MAX;
+    s->lastUs = 0;
+    s->end = 0;
+}
+
+static void parseRange(const Capture& c, size_t from, size_t to, Summary* s) {
+    resetSummary(s);
+
+    size_t pos = from;
+    while (pos < to) {
+        size_t len = recordAt(c, pos);
+        if (!len) break;
+        const uint8_t* h = c.data + pos;
+        const uint8_t* f = h + PCAP_RECORD_HEADER_SIZE;
+        size_t flen = len - PCAP_RECORD_HEADER_SIZE;
+        uint64_t us = (uint64_t)pcapLe32(h) * 1000000 + pcapLe32(h + 4);
+        if (us < s->firstUs) s->firstUs = us;
+        if (us > s->lastUs) s->lastUs = us;
+        s->records++;
+        s->bytes += flen;
+
+        if (flen >= 2) {
+            uint8_t type = dot11Type(f);
+            if (type < 3) s->types[type][dot11Subtype(f)]++;
+            if (dot11Retry(f)) s->retries++;
+
+            const uint8_t* bssid = dot11Bssid(f, flen);
+            if (bssid) {
+                Bss& b = s->bss[macKey(bssid)];
+                if (!b.frames) memcpy(b.mac, bssid, 6);
+                b.frames++;
+                b.bytes += flen;
+                b.offsets.push_back(pos);
+                if (type == DOT11_TYPE_DATA) b.data++;
+                if (dot11HasBeaconIes(f)) {
+                    if (dot11Subtype(f) == DOT11_SUBTYPE_BEACON) b.beacons++;
+                    Dot11BeaconInfo info = dot11BeaconInfo(f, flen);
+                    if (info.channel) b.channel = info.channel;
+                    if (info.ssid && !b.ssidLen) {
+                        memcpy(b.ssid, info.ssid, info.ssidLen);
+                        b.ssidLen = info.ssidLen;
+                    }
+                }
+            }
+        }
+        pos += len;
+    }
+    s->end = pos;
+}
+
+// Ranges are merged in file order, so each BSSID's offsets stay sorted
+static void mergeInto(Summary* into, Summary& from) {
+    for (int t = 0; t < 3; t++) {
+        for (int st = 0; st < 16; st++) into->types[t][st] += from.types[t][st];
+    }
+    into->records += from.records;
+    into->bytes += from.bytes;
+    into->retries += from.retries;
+    into->firstUs = std::min(into->firstUs, from.firstUs);
+    into->lastUs = std::max(into->lastUs, from.lastUs);
+    into->end = from.end;
+
+    for (auto& kv : from.bss) {
+        Bss& src = kv.second;
+        auto it = into->bss.find(kv.first);
+        if (it == into->bss.end()) {
+            into->bss.emplace(kv.first, std::move(src));
+            continue;
+        }
+        Bss& dst = it->second;
+        dst.frames += src.frames;
+        dst.bytes += src.bytes;
+        dst.beacons += src.beacons;
+        dst.data += src.data;
+        if (src.channel) dst.channel = src.channel;
+        if (!dst.ssidLen && src.ssidLen) {
+            memcpy(dst.ssid, src.ssid, src.ssidLen);
+            dst.ssidLen = src.ssidLen;
+        }
+        dst.offsets.insert(dst.offsets.end(), src.offsets.begin(), src.offsets.end());
+    }
+}
+
+// Threads actually used: small captures get fewer, down to one
+static unsigned indexThreads(const Capture& c, unsigned threads) {
+    size_t body = c.size - PCAP_GLOBAL_HEADER_SIZE;
+    if (threads > 1 && body / threads < MIN_RANGE) threads = std::max<size_t>(1, body / MIN_RANGE);
+    return threads;
+}
+
+static bool indexCapture(const Capture& c, unsigned threads, Summary* out) {
+    size_t body = c.size - PCAP_GLOBAL_HEADER_SIZE;
+    threads = indexThreads(c, threads);
+
+    std::vector<size_t> cuts(threads + 1);
+    cuts[0] = PCAP_GLOBAL_HEADER_SIZE;
+    cuts[threads] = c.size;
+    for (unsigned i = 1; i < threads; i++) {
+        size_t from = std::max(cuts[i - 1], PCAP_GLOBAL_HEADER_SIZE + body / threads * i);
+        cuts[i] = findBoundary(c, from, c.size);
+    }
+
+    std::vector<Summary> parts(threads);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(parseRange, std::cref(c), cuts[i], cuts[i + 1], &parts[i]);
+    }
+    for (auto& w : workers) w.join();
+
+    bool chained = true;
+    for (unsigned i = 0; i + 1 < threads; i++) chained &= parts[i].end == cuts[i + 1];
+    if (!chained) {
+        fprintf(stderr, "range cuts missed a record boundary, reparsing on one thread\n");
+        parts.assign(1, Summary());
+        parseRange(c, PCAP_GLOBAL_HEADER_SIZE, c.size, &parts[0]);
+    }
+
+    resetSummary(out);
+    for (auto& p : parts) mergeInto(out, p);
+    if (out->records == 0) out->firstUs = 0;
+    return chained;
+}
+
+static std::string indexPath(const char* path) {
+    return std::string(path) + ".idx";
+}
+
+static bool writeIndex(const char* path, const Capture& c, const Summary& s) {
+    std::string idx = indexPath(path);
+    FILE* f = fopen(idx.c_str(), "wb");
+    if (!f) {
+        perror(idx.c_str());
+        return false;
+    }
+    IdxHeader h = {};
+    h.magic = IDX_MAGIC;
+    h.version = IDX_VERSION;
+    h.pcapSize = c.size;
+    h.pcapMtime = c.mtime;
+    h.valid = s.end;
+    h.records = s.records;
+    h.bytes = s.bytes;
+    h.retries = s.retries;
+    h.firstUs = s.firstUs;
+    h.lastUs = s.lastUs;
+    memcpy(h.types, s.types, sizeof(h.types));
+    h.bssCount = s.bss.size();
+    fwrite(&h, sizeof(h), 1, f);
+
+    for (const auto& kv : s.bss) {
+        const Bss& b = kv.second;
+        IdxBss e = {};
+        memcpy(e.mac, b.mac, 6);
+        e.channel = b.channel;
+        e.ssidLen = b.ssidLen;
+        memcpy(e.ssid, b.ssid, b.ssidLen);
+        e.frames = b.frames;
+        e.bytes = b.bytes;
+        e.beacons = b.beacons;
+        e.data = b.data;
+        e.offsetCount = b.offsets.size();
+        fwrite(&e, sizeof(e), 1, f);
+    }
+    for (const auto& kv : s.bss) {
+        fwrite(kv.second.offsets.data(), sizeof(uint64_t), kv.second.offsets.size(), f);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// Loads a cached index if it matches the capture's size and mtime
+static bool readIndex(const char* path, const Capture& c, Summary* s) {
+    FILE* f = fopen(indexPath(path).c_str(), "rb");
+    if (!f) return false;
+    IdxHeader h;
+    bool ok = fread(&h, sizeof(h), 1, f) == 1 && h.magic == IDX_MAGIC && h.version == IDX_VERSION &&
+              h.pcapSize == c.size && h.pcapMtime == c.mtime;
+    if (ok) {
+        s->end = h.valid;
+        s->records = h.records;
+        s->bytes = h.bytes;
+        s->retries = h.retries;
+        s->firstUs = h.firstUs;
+        s->lastUs = h.lastUs;
+        memcpy(s->types, h.types, sizeof(h.types));
+
+        std::vector<IdxBss> table(h.bssCount);
+        ok = fread(table.data(), sizeof(IdxBss), table.size(), f) == table.size();
+        for (size_t i = 0; ok && i < table.size(); i++) {
+            const IdxBss& e = table[i];
+            Bss& b = s->bss[macKey(e.mac)];
+            memcpy(b.mac, e.mac, 6);
+            b.channel = e.channel;
+            b.ssidLen = std::min<uint8_t>(e.ssidLen, 32);
+            memcpy(b.ssid, e.ssid, b.ssidLen);
+            b.frames = e.frames;
+            b.bytes = e.bytes;
+            b.beacons = e.beacons;
+            b.data = e.data;
+            b.offsets.resize(e.offsetCount);
+            ok = fread(b.offsets.data(), sizeof(uint64_t), e.offsetCount, f) == e.offsetCount;
+        }
+    }
+    fclose(f);
+    if (!ok) s->bss.clear();
+    return ok;
+}
+
+static bool openCapture(const char* path, Capture* c) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    c->size = st.st_size;
+    c->mtime = st.st_mtime;
+    c->data = nullptr;
+    if (c->size >= PCAP_GLOBAL_HEADER_SIZE) {
+        void* m = mmap(nullptr, c->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            c->data = (const uint8_t*)m;
+            madvise(m, c->size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+    if (!c->data || pcapLe32(c->data) != PCAP_MAGIC) {
+        fprintf(stderr, "%s: not a pcap capture\n", path);
+        if (c->data) munmap((void*)c->data, c->size);
+        return false;
+    }
+    c->snaplen = pcapLe32(c->data + 16);
+    return true;
+}
+
+static void closeCapture(Capture* c) {
+    munmap((void*)c->data, c->size);
+}
+
+static void printMac(const uint8_t* m) {
+    printf("%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+}
+
+static void printSummary(const char* path, const Capture& c, const Summary& s, bool all) {
+    printf("%s: %llu records, %.1f MB, %.1f s span", path, (unsigned long long)s.records,
+           c.size / 1e6, (s.lastUs - s.firstUs) / 1e6);
+    if (s.end < c.size) printf(", %zu torn bytes at %zu", c.size - s.end, s.end);
+    printf("\n");
+
+    uint64_t retriesPct = s.records ? s.retries * 100 / s.records : 0;
+    for (int t = 0; t < 3; t++) {
+        uint64_t n = 0;
+        for (int st = 0; st < 16; st++) n += s.types[t][st];
+        printf("  %-5s %10llu", TYPE_NAMES[t], (unsigned long long)n);
+        if (t == DOT11_TYPE_MGMT) {
+            for (int st = 0; st < 16; st++) {
+                if (s.types[t][st]) printf(" | %s %llu", MGMT_NAMES[st], (unsigned long long)s.types[t][st]);
+            }
+        }
+        printf("\n");
+    }
+    printf("  retry %10llu (%llu%%)\n", (unsigned long long)s.retries, (unsigned long long)retriesPct);
+
+    uint64_t chFrames[256] = {}, chBss[256] = {};
+    for (const auto& kv : s.bss) {
+        chFrames[kv.second.channel] += kv.second.frames;
+        chBss[kv.second.channel]++;
+    }
+    printf("  Channels:");
+    for (int ch = 1; ch < 256; ch++) {
+        if (chBss[ch]) printf(" %d: %llu frames / %llu BSS |", ch, (unsigned long long)chFrames[ch],
+                              (unsigned long long)chBss[ch]);
+    }
+    if (chBss[0]) printf(" ?: %llu frames / %llu BSS", (unsigned long long)chFrames[0], (unsigned long long)chBss[0]);
+    printf("\n");
+
+    std::vector<const Bss*> order;
+    for (const auto& kv : s.bss) order.push_back(&kv.second);
+    std::sort(order.begin(), order.end(), [](const Bss* a, const Bss* b) { return a->frames > b->frames; });
+    size_t shown = all ? order.size() : std::min<size_t>(order.size(), TOP_BSSIDS);
+    printf("  %zu BSSIDs%s\n", order.size(), shown < order.size() ? " (top by frames, --all for every one)" : "");
+    printf("  %-17s %3s %10s %12s %8s %10s  %s\n", "BSSID", "CH", "frames", "bytes", "beacons", "data", "SSID");
+    for (size_t i = 0; i < shown; i++) {
+        const Bss* b = order[i];
+        printf("  ");
+        printMac(b->mac);
+        if (b->channel) printf(" %3u", b->channel);
+        else printf(" %3s", "?");
+        printf(" %10llu %12llu %8u %10u  %.*s\n", (unsigned long long)b->frames,
+               (unsigned long long)b->bytes, b->beacons, b->data, b->ssidLen, b->ssid);
+    }
+}
+
+static bool loadSummary(const char* path, const Capture& c, unsigned threads, bool rebuild, Summary* s) {
+    if (!rebuild && readIndex(path, c, s)) {
+        fprintf(stderr, "%s: using %s\n", path, indexPath(path).c_str());
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    indexCapture(c, threads, s);
+    double t = seconds(start);
+    unsigned used = indexThreads(c, threads);
+    fprintf(stderr, "%s: indexed in %.3f s on %u thread%s (%.0f MB/s)\n", path, t, used, used == 1 ? "" : "s",
+            c.size / 1e6 / std::max(t, 1e-6));
+    writeIndex(path, c, *s);
+    return true;
+}
+
+// Copies the records of every BSSID matching the filter into a new capture
+static int exportSlice(const char* path, const char* out, const uint8_t* mac, int channel,
+                       unsigned threads, bool rebuild) {
+    Capture c;
+    if (!openCapture(path, &c)) return 1;
+    Summary s;
+    loadSummary(path, c, threads, rebuild, &s);
+
+    std::vector<uint64_t> offsets;
+    for (const auto& kv : s.bss) {
+        const Bss& b = kv.second;
+        if (mac && memcmp(b.mac, mac, 6) != 0) continue;
+        if (channel >= 0 && b.channel != channel) continue;
+        offsets.insert(offsets.end(), b.offsets.begin(), b.offsets.end());
+    }
+    std::sort(offsets.begin(), offsets.end());
+
+    FILE* f = fopen(out, "wb");
+    if (!f) {
+        perror(out);
+        closeCapture(&c);
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    fwrite(c.data, 1, PCAP_GLOBAL_HEADER_SIZE, f);
+    uint64_t bytes = PCAP_GLOBAL_HEADER_SIZE;
+    for (uint64_t off : offsets) {
+        size_t len = recordAt(c, off);
+        fwrite(c.data + off, 1, len, f);
+        bytes += len;
+    }
+    fclose(f);
+    fprintf(stderr, "%s: %zu records, %.1f MB in %.3f s\n", out, offsets.size(), bytes / 1e6, seconds(start));
+    closeCapture(&c);
+    return offsets.empty() ? 1 : 0;
+}
+
+static void put32(FILE* f, uint32_t x) {
+    fwrite(&x, 4, 1, f);
+}
+
+// Beacons, probes, data and ACKs from a handful of APs over channels 1-11,
+// laid out like the sniffer's captures
+static int generate(const char* path, uint32_t records) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    uint8_t hdr[PCAP_GLOBAL_HEADER_SIZE] = { 0xd4, 0xc3, 0xb2, 0xa1, 2, 0, 4, 0 };
+    uint32_t snaplen = 65535, linktype = 105;
+    memcpy(hdr + 16, &snaplen, 4);
+    memcpy(hdr + 20, &linktype, 4);
+    fwrite(hdr, 1, sizeof(hdr), f);
+
+    srand(1);
+    const int aps = 40;
+    uint64_t us = 0;
+    uint8_t frame[2560];
+    for (uint32_t i = 0; i < records; i++) {
+        int ap = rand() % aps;
+        uint8_t bssid[6] = { 0x02, 0x11, 0x22, 0x33, 0x44, (uint8_t)ap };
+        uint8_t sta[6] = { 0x02, 0xaa, 0xbb, 0xcc, (uint8_t)(rand() % 8), (uint8_t)ap };
+        memset(frame, 0, DOT11_HEADER_SIZE);
+        size_t len;
+        int kind = rand() % 10;
+        if (kind < 3) {
+            // Beacon with SSID and DS parameter set
+            frame[0] = DOT11_SUBTYPE_BEACON << 4;
+            memset(frame + 4, 0xff, 6);
+            memcpy(frame + 10, bssid, 6);
+            memcpy(frame + 16, bssid, 6);
+            len = DOT11_HEADER_SIZE + DOT11_BEACON_FIXED;
+            int n = snprintf((char*)frame + len + 2, 33, "net-%02d", ap);
+            frame[len] = DOT11_IE_SSID;
+            frame[len + 1] = n;
+            len += 2 + n;
+            frame[len++] = DOT11_IE_DS_PARAMS;
+            frame[len++] = 1;
+            frame[len++] = 1 + ap % 11;
+            size_t pad = rand() % 200;
+            for (size_t k = 0; k < pad; k++) frame[len++] = rand();  // Vendor IEs stand-in
+        } else if (kind < 8) {
+            // Data from DS, random payload
+            frame[0] = DOT11_TYPE_DATA << 2;
+            frame[1] = 2 | (rand() % 8 == 0 ? 0x08 : 0);
+            memcpy(frame + 4, sta, 6);
+            memcpy(frame + 10, bssid, 6);
+            memcpy(frame + 16, bssid, 6);
+            len = DOT11_HEADER_SIZE + rand() % 1500;
+            for (size_t k = DOT11_HEADER_SIZE; k < len; k++) frame[k] = rand();
+        } else if (kind < 9) {
+            frame[0] = DOT11_SUBTYPE_PROBE_REQ << 4;
+            memset(frame + 4, 0xff, 6);
+            memcpy(frame + 10, sta, 6);
+            memset(frame + 16, 0xff, 6);
+            len = DOT11_HEADER_SIZE + 2;
+        } else {
+            frame[0] = (13 << 4) | (DOT11_TYPE_CTRL << 2);  // ACK
+            memcpy(frame + 4, sta, 6);
+            len = 10;
+        }
+        len += DOT11_FCS_SIZE;
+        us += rand() % 2000;
+        put32(f, us / 1000000);
+        put32(f, us % 1000000);
+        put32(f, len);
+        put32(f, len);
+        fwrite(frame, 1, len, f);
+    }
+    fclose(f);
+    printf("%s: %u records\n", path, records);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "--gen") == 0) {
+        return generate(argv[2], strtoul(argv[3], nullptr, 10));
+    }
+
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool all = false, rebuild = false, haveMac = false;
+    uint8_t mac[6];
+    int channel = -1;
+    const char* out = nullptr;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        bool more = i + 1 < argc;
+        if (strcmp(argv[i], "--threads") == 0 && more) threads = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--all") == 0) all = true;
+        else if (strcmp(argv[i], "--rebuild") == 0) rebuild = true;
+        else if (strcmp(argv[i], "--channel") == 0 && more) channel = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0 && more) out = argv[++i];
+        else if (strcmp(argv[i], "--bssid") == 0 && more) {
+            haveMac = parseMac(argv[++i], mac);
+            if (!haveMac) {
+                fprintf(stderr, "bad BSSID: %s\n", argv[i]);
+                return 2;
+            }
+        } else paths.push_back(argv[i]);
+    }
+
+    bool slice = haveMac || channel >= 0;
+    if (paths.empty() || (slice && (!out || paths.size() != 1))) {
+        fprintf(stderr,
+                "usage: %s [--threads N] [--all] [--rebuild] capture.pcap [...]\n"
+                "       %s [--bssid MAC] [--channel N] -o out.pcap capture.pcap\n"
+                "       %s --gen capture.pcap records\n", argv[0], argv[0], argv[0]);
+        return 2;
+    }
+    if (slice) return exportSlice(paths[0], out, haveMac ? mac : nullptr, channel, threads, rebuild);
+
+    int failed = 0;
+    for (const char* path : paths) {
+        Capture c;
+        if (!openCapture(path, &c)) {
+            failed++;
+            continue;
+        }
+        Summary s;
+        loadSummary(path, c, threads, rebuild, &s);
+        printSummary(path, c, s, all);
+        closeCapture(&c);
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,481 @@
+// Merges per-node sniffer captures into one time-ordered pcapng.
+//
+//   pcap-merge -o merged.pcapng n0-capture.pcap n1-capture.pcap [...]
+//   pcap-merge --keep-sync -o merged.pcapng ...    keep the sync beacons
+//   pcap-merge --simulate N [seed]                 N nodes with skewed clocks
+//
+// Each node stamps frames with its own esp_timer clock, which starts at its
+// own boot and drifts by tens of ppm. The sync node (sync=1 in node.cfg)
+// sends sync beacons carrying its clock on every channel (sync_beacon.h);
+// each reception is a (reference us, local us) pair. Pass 1 streams every
+// capture once, fits local = slope * ref + offset by least squares per node,
+// drops receptions more than FIT_OUTLIER_RMS x RMS off (late callbacks) and
+// refits. Pass 2 is a k-way merge on the mapped time: one record per input
+// in memory and a heap of k entries, so memory does not depend on capture
+// size. Inputs are assumed in order within themselves, as the sniffer
+// writes them. Each input becomes one pcapng interface, named after the
+// file, with its fit in the description.
+//
+// --simulate writes N node captures from a known true timeline (random
+// boot offsets, +-30 ppm drift, 20-200 us reception jitter, node 0 as sync
+// source), merges them and checks the output is ordered and every frame
+// lands within SIM_TOLERANCE_US of the reference clock. Exit status is
+// non-zero on mismatch.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/pcap-merge.cpp -o pcap-merge
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "pcap_scan.h"
+#include "sync_beacon.h"
+
+#define READ_BUFFER (1 << 20)
+#define FIT_OUTLIER_RMS 4
+#define FIT_OUTLIER_MIN_US 200
+#define SIM_DURATION_US 600000000ULL  // 10 min
+#define SIM_TOLERANCE_US 400
+
+struct Input {
+    FILE* f;
+    std::string name;
+    uint32_t snaplen;
+    uint32_t linktype;
+    std::vector<uint8_t> data;  // Current record
+    uint32_t len;
+    uint64_t localUs;
+    uint64_t records;
+    bool torn;
+
+    // Clock fit: local = slope * ref + offset
+    std::vector<std::pair<double, double>> pairs;  // (ref, local)
+    double slope;
+    double offset;
+    uint32_t used;
+    double rmsUs;
+    bool aligned;
+};
+
+static bool openInput(Input* in, FILE* f, const std::string& name) {
+    in->f = f;
+    in->name = name;
+    in->records = 0;
+    in->torn = false;
+    in->slope = 1;
+    in->offset = 0;
+    in->used = 0;
+    in->rmsUs = 0;
+    in->aligned = false;
+    setvbuf(f, nullptr, _IOFBF, READ_BUFFER);
+    uint8_t h[PCAP_GLOBAL_HEADER_SIZE];
+    if (fread(h, 1, sizeof(h), f) != sizeof(h) || pcapLe32(h) != PCAP_MAGIC) {
+        fprintf(stderr, "%s: not a pcap capture\n", name.c_str());
+        return false;
+    }
+    in->snaplen = pcapLe32(h + 16);
+    in->linktype = pcapLe32(h + 20);
+    in->data.resize(std::min<uint32_t>(in->snaplen, 65535));
+    return true;
+}
+
+static void rewindInput(Input* in) {
+    fseek(in->f, PCAP_GLOBAL_HEADER_SIZE, SEEK_SET);
+    in->records = 0;
+}
+
+// Next complete record; a torn or implausible one ends the input (pcap_scan.h rules)
+static bool nextRecord(Input* in) {
+    uint8_t h[PCAP_RECORD_HEADER_SIZE];
+    size_t got = fread(h, 1, sizeof(h), in->f);
+    if (got == 0) return false;
+    uint32_t usec = pcapLe32(h + 4);
+    uint32_t incl = pcapLe32(h + 8);
+    uint32_t orig = pcapLe32(h + 12);
+    if (got < sizeof(h) || usec >= 1000000 || incl == 0 || incl > in->snaplen || incl > orig ||
+        incl > in->data.size() || fread(in->data.data(), 1, incl, in->f) != incl) {
+        in->torn = true;
+        return false;
+    }
+    in->len = incl;
+    in->localUs = (uint64_t)pcapLe32(h) * 1000000 + usec;
+    in->records++;
+    return true;
+}
+
+static bool isSync(const Input* in, SyncBeacon* sb) {
+    return syncBeaconParse(in->data.data(), in->len, sb);
+}
+
+static void fitOnce(Input* in, const std::vector<bool>& keep) {
+    double n = 0, mr = 0, ml = 0;
+    for (size_t i = 0; i < in->pairs.size(); i++) {
+        if (!keep[i]) continue;
+        n++;
+        mr += in->pairs[i].first;
+        ml += in->pairs[i].second;
+    }
+    in->used = n;
+    if (n == 0) return;
+    mr /= n;
+    ml /= n;
+    double sxy = 0, sxx = 0;
+    for (size_t i = 0; i < in->pairs.size(); i++) {
+        if (!keep[i]) continue;
+        double dr = in->pairs[i].first - mr;
+        sxx += dr * dr;
+        sxy += dr * (in->pairs[i].second - ml);
+    }
+    // One burst (or one reception) only gives the offset
+    in->slope = sxx > 1e6 ? sxy / sxx : 1;
+    in->offset = ml - in->slope * mr;
+
+    double ss = 0;
+    for (size_t i = 0; i < in->pairs.size(); i++) {
+        if (!keep[i]) continue;
+        double r = in->pairs[i].second - (in->slope * in->pairs[i].first + in->offset);
+        ss += r * r;
+    }
+    in->rmsUs = sqrt(ss / n);
+}
+
+static void fitClock(Input* in) {
+    std::vector<bool> keep(in->pairs.size(), true);
+    fitOnce(in, keep);
+    if (in->used < 3) {
+        in->aligned = in->used > 0;
+        return;
+    }
+    double limit = std::max(FIT_OUTLIER_RMS * in->rmsUs, (double)FIT_OUTLIER_MIN_US);
+    for (size_t i = 0; i < in->pairs.size(); i++) {
+        double r = in->pairs[i].second - (in->slope * in->pairs[i].first + in->offset);
+        keep[i] = fabs(r) <= limit;
+    }
+    fitOnce(in, keep);
+    in->aligned = in->used > 0;
+}
+
+static uint64_t mappedUs(const Input* in) {
+    double ref = (in->localUs - in->offset) / in->slope;
+    return ref > 0 ? (uint64_t)llround(ref) : 0;
+}
+
+static void put16(FILE* f, uint16_t x) {
+    fwrite(&x, 2, 1, f);
+}
+
+static void put32(FILE* f, uint32_t x) {
+    fwrite(&x, 4, 1, f);
+}
+
+static void putOption(FILE* f, uint16_t code, const std::string& value) {
+    static const uint8_t zeros[4] = {};
+    put16(f, code);
+    put16(f, value.size());
+    fwrite(value.data(), 1, value.size(), f);
+    fwrite(zeros, 1, (4 - value.size() % 4) % 4, f);
+}
+
+static uint32_t optionSize(const std::string& value) {
+    return 4 + (value.size() + 3) / 4 * 4;
+}
+
+static void writeSectionHeader(FILE* out) {
+    put32(out, 0x0a0d0d0a);
+    put32(out, 28);
+    put32(out, 0x1a2b3c4d);
+    put16(out, 1);
+    put16(out, 0);
+    put32(out, 0xffffffff);  // Section length unknown
+    put32(out, 0xffffffff);
+    put32(out, 28);
+}
+
+static void writeInterface(FILE* out, const Input& in) {
+    char desc[160];
+    if (in.aligned) {
+        snprintf(desc, sizeof(desc), "offset %.3f s, drift %+.2f ppm, %u sync pairs, rms %.0f us",
+                 in.offset / 1e6, (in.slope - 1) * 1e6, in.used, in.rmsUs);
+    } else {
+        snprintf(desc, sizeof(desc), "unaligned (no sync beacons heard)");
+    }
+    std::string name = in.name, description = desc;
+    uint32_t len = 20 + optionSize(name) + optionSize(description) + 4;
+    put32(out, 1);
+    put32(out, len);
+    put16(out, in.linktype);
+    put16(out, 0);
+    put32(out, in.snaplen);
+    putOption(out, 2, name);         // if_name
+    putOption(out, 3, description);  // if_description
+    put32(out, 0);                   // opt_endofopt
+    put32(out, len);
+}
+
+static void writePacket(FILE* out, uint32_t iface, uint64_t us, const uint8_t* data, uint32_t len) {
+    static const uint8_t zeros[4] = {};
+    uint32_t padded = (len + 3) / 4 * 4;
+    uint32_t total = 32 + padded;
+    put32(out, 6);
+    put32(out, total);
+    put32(out, iface);
+    put32(out, us >> 32);
+    put32(out, us);
+    put32(out, len);
+    put32(out, len);
+    fwrite(data, 1, len, out);
+    fwrite(zeros, 1, padded - len, out);
+    put32(out, total);
+}
+
+struct Head {
+    uint64_t us;
+    uint32_t input;
+    bool operator>(const Head& o) const { return us != o.us ? us > o.us : input > o.input; }
+};
+
+// Returns the number of records written, or -1 if no input could be aligned
+static int64_t merge(std::vector<Input>& inputs, FILE* out, bool keepSync) {
+    // Pass 1: sync receptions. The first sync node seen is the reference.
+    int refNode = -1;
+    uint64_t foreign = 0;
+    for (Input& in : inputs) {
+        SyncBeacon sb;
+        while (nextRecord(&in)) {
+            if (!isSync(&in, &sb)) continue;
+            if (refNode < 0) refNode = sb.node;
+            if (sb.node != refNode) {
+                foreign++;
+                continue;
+            }
+            in.pairs.push_back(std::make_pair((double)sb.txUs, (double)in.localUs));
+        }
+        fitClock(&in);
+    }
+    if (refNode < 0) {
+        fprintf(stderr, "no sync beacons in any input - is one node configured with sync=1?\n");
+        return -1;
+    }
+    if (foreign) fprintf(stderr, "ignored %llu sync beacons from other sync nodes\n", (unsigned long long)foreign);
+
+    writeSectionHeader(out);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        Input& in = inputs[i];
+        writeInterface(out, in);
+        if (in.aligned) {
+            fprintf(stderr, "%s: %llu records, offset %.3f s, drift %+.2f ppm, %u/%zu sync pairs, rms %.0f us%s\n",
+                    in.name.c_str(), (unsigned long long)in.records, in.offset / 1e6, (in.slope - 1) * 1e6,
+                    in.used, in.pairs.size(), in.rmsUs, in.torn ? ", torn tail" : "");
+        } else {
+            fprintf(stderr, "%s: %llu records, NOT ALIGNED (no sync beacons)\n", in.name.c_str(),
+                    (unsigned long long)in.records);
+        }
+    }
+
+    // Pass 2: k-way merge
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        rewindInput(&inputs[i]);
+        if (nextRecord(&inputs[i])) heap.push({ mappedUs(&inputs[i]), (uint32_t)i });
+    }
+    int64_t written = 0;
+    SyncBeacon sb;
+    while (!heap.empty()) {
+        Head h = heap.top();
+        heap.pop();
+        Input& in = inputs[h.input];
+        if (keepSync || !isSync(&in, &sb)) {
+            writePacket(out, h.input, h.us, in.data.data(), in.len);
+            written++;
+        }
+        if (nextRecord(&in)) heap.push({ mappedUs(&in), h.input });
+    }
+    return written;
+}
+
+static std::string baseName(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void simPut32(FILE* f, uint32_t x) {
+    fwrite(&x, 4, 1, f);
+}
+
+static void simRecord(FILE* f, uint64_t us, const uint8_t* data, uint32_t len) {
+    simPut32(f, us / 1000000);
+    simPut32(f, us % 1000000);
+    simPut32(f, len);
+    simPut32(f, len);
+    fwrite(data, 1, len, f);
+}
+
+static double simRand() {
+    return rand() / (RAND_MAX + 1.0);
+}
+
+struct SimNode {
+    double ppm;
+    double bootUs;  // True time at which this node's clock read 0
+    uint16_t channels;
+    uint64_t lastUs;
+};
+
+static uint64_t simClock(const SimNode& n, double trueUs) {
+    return (uint64_t)((trueUs - n.bootUs) * (1 + n.ppm * 1e-6));
+}
+
+// Reception stamp: like the sniffer, never before the previous record's
+static uint64_t simStamp(SimNode& n, double trueUs) {
+    n.lastUs = std::max(n.lastUs, simClock(n, trueUs));
+    return n.lastUs;
+}
+
+static int simulate(uint32_t nodes, unsigned seed) {
+    srand(seed);
+    if (nodes < 1 || nodes > 13) nodes = 3;
+    std::vector<SimNode> sim(nodes);
+    for (uint32_t i = 0; i < nodes; i++) {
+        sim[i].ppm = (simRand() * 2 - 1) * 30;
+        sim[i].bootUs = -simRand() * 100e6;
+        sim[i].channels = 0;
+        sim[i].lastUs = 0;
+    }
+    for (int ch = 1; ch <= 13; ch++) sim[(ch - 1) * nodes / 13].channels |= 1 << ch;
+
+    // Events in true time, written per node in order
+    std::vector<FILE*> files(nodes);
+    uint8_t hdr[PCAP_GLOBAL_HEADER_SIZE] = { 0xd4, 0xc3, 0xb2, 0xa1, 2, 0, 4, 0 };
+    uint32_t snaplen = 65535, linktype = 105;
+    memcpy(hdr + 16, &snaplen, 4);
+    memcpy(hdr + 20, &linktype, 4);
+    for (uint32_t i = 0; i < nodes; i++) {
+        files[i] = tmpfile();
+        fwrite(hdr, 1, sizeof(hdr), files[i]);
+    }
+
+    uint64_t frames = 0;
+    uint32_t seq = 0;
+    uint8_t frame[SYNC_BEACON_MAX + 64];
+    for (double t = 0; t < SIM_DURATION_US;) {
+        if (fmod(t, SYNC_INTERVAL_MS * 1000.0) < 1000) {
+            // Sync burst: node 0 steps through all channels, 1 ms apart
+            seq++;
+            for (int ch = 1; ch <= 13; ch++) {
+                double tx = t + (ch - 1) * 1000;
+                uint64_t txUs = simStamp(sim[0], tx);
+                size_t len = syncBeaconBuild(frame, 0, seq, ch, txUs);
+                simRecord(files[0], txUs, frame, len);
+                for (uint32_t i = 1; i < nodes; i++) {
+                    if (!(sim[i].channels & (1 << ch))) continue;
+                    double rx = tx + 20 + simRand() * 180;
+                    simRecord(files[i], simStamp(sim[i], rx), frame, len);
+                }
+            }
+            t += 13 * 1000;
+            continue;
+        }
+        // Data frame carrying its true time, heard by one node
+        uint32_t node = rand() % nodes;
+        uint64_t trueUs = (uint64_t)t;
+        memset(frame, 0, DOT11_HEADER_SIZE);
+        frame[0] = DOT11_TYPE_DATA << 2;
+        memcpy(frame + DOT11_HEADER_SIZE, &trueUs, 8);
+        double rx = t + 20 + simRand() * 180;
+        simRecord(files[node], simStamp(sim[node], rx), frame, DOT11_HEADER_SIZE + 8 + DOT11_FCS_SIZE);
+        frames++;
+        t += 50 + simRand() * 2000;
+    }
+
+    std::vector<Input> inputs(nodes);
+    for (uint32_t i = 0; i < nodes; i++) {
+        rewind(files[i]);
+        char name[16];
+        snprintf(name, sizeof(name), "n%u", i);
+        openInput(&inputs[i], files[i], name);
+    }
+    FILE* out = tmpfile();
+    int64_t written = merge(inputs, out, false);
+
+    // Read the EPBs back: ordered, and each frame at its true time on the
+    // reference (node 0) clock
+    rewind(out);
+    uint32_t type, len;
+    uint64_t last = 0, checked = 0, disorder = 0, off = 0;
+    double maxErr = 0;
+    std::vector<uint8_t> block;
+    while (fread(&type, 4, 1, out) == 1 && fread(&len, 4, 1, out) == 1 && len >= 12) {
+        block.resize(len - 8);
+        if (fread(block.data(), 1, block.size(), out) != block.size()) break;
+        if (type != 6) continue;
+        uint32_t hi, lo;
+        memcpy(&hi, &block[4], 4);
+        memcpy(&lo, &block[8], 4);
+        uint64_t us = (uint64_t)hi << 32 | lo;
+        if (us < last) disorder++;
+        last = us;
+        uint64_t trueUs;
+        memcpy(&trueUs, &block[20 + DOT11_HEADER_SIZE], 8);
+        double err = fabs((double)us - (double)simClock(sim[0], trueUs + 110));
+        maxErr = std::max(maxErr, err);
+        if (err > SIM_TOLERANCE_US) off++;
+        checked++;
+    }
+    for (FILE* f : files) fclose(f);
+    fclose(out);
+
+    bool ok = written == (int64_t)frames && checked == frames && !disorder && !off;
+    printf("%u nodes (seed %u): %llu frames merged, %llu out of order, max error %.0f us, "
+           "%llu beyond %d us: %s\n", nodes, seed, (unsigned long long)checked,
+           (unsigned long long)disorder, maxErr, (unsigned long long)off, SIM_TOLERANCE_US,
+           ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "--simulate") == 0) {
+        unsigned seed = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1;
+        return simulate(strtoul(argv[2], nullptr, 10), seed);
+    }
+
+    bool keepSync = false;
+    const char* outPath = nullptr;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--keep-sync") == 0) keepSync = true;
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) outPath = argv[++i];
+        else paths.push_back(argv[i]);
+    }
+    if (!outPath || paths.empty()) {
+        fprintf(stderr, "usage: %s [--keep-sync] -o merged.pcapng node.pcap [...] | --simulate N [seed]\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::vector<Input> inputs(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        FILE* f = fopen(paths[i], "rb");
+        if (!f) {
+            perror(paths[i]);
+            return 1;
+        }
+        if (!openInput(&inputs[i], f, baseName(paths[i]))) return 1;
+    }
+    FILE* out = fopen(outPath, "wb");
+    if (!out) {
+        perror(outPath);
+        return 1;
+    }
+    int64_t written = merge(inputs, out, keepSync);
+    fclose(out);
+    for (Input& in : inputs) fclose(in.f);
+    if (written < 0) return 1;
+    printf("%s: %lld records from %zu captures\n", outPath, (long long)written, inputs.size());
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Host-side repair and truncation check for sniffer pcap captures.
+//
+//   pcap-repair capture.pcap [...]       cut torn trailing records in place
+//   pcap-repair --check capture.pcap     report only
+//   pcap-repair --simulate N [seed]      N random power-cut truncations
+//
+// Repair uses the same scan as the sniffer's boot-time recovery
+// (include/pcap_scan.h). --simulate builds a capture shaped like the
+// sniffer's (records of 1..2559 bytes), cuts it at N random offsets - half of
+// them followed by a zero-filled tail, as FAT leaves after a lost sync - and
+// checks each scan keeps exactly the records that ended before the cut, and
+// that the repaired file rescans clean. With a zero tail the record
+// straddling the cut may also be kept, its lost bytes reading as zeros: it is
+// structurally intact, so nothing can tell it apart. Exit status is non-zero
+// on mismatch.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/pcap-repair.cpp -o pcap-repair
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "pcap_scan.h"
+
+#define SCAN_CHUNK 4096
+
+struct FileReader {
+    FILE* f;
+    size_t operator()(size_t offset, uint8_t* buf, size_t len) {
+        if (fseek(f, offset, SEEK_SET) != 0) return 0;
+        return fread(buf, 1, len, f);
+    }
+};
+
+struct MemReader {
+    const std::vector<uint8_t>* data;
+    size_t operator()(size_t offset, uint8_t* buf, size_t len) {
+        if (offset >= data->size()) return 0;
+        if (len > data->size() - offset) len = data->size() - offset;
+        memcpy(buf, data->data() + offset, len);
+        return len;
+    }
+};
+
+static void put32(std::vector<uint8_t>& v, uint32_t x) {
+    for (int i = 0; i < 4; i++) v.push_back(x >> (8 * i));
+}
+
+static void put16(std::vector<uint8_t>& v, uint16_t x) {
+    v.push_back(x);
+    v.push_back(x >> 8);
+}
+
+// Same layout as the sniffer's initPcapHeader/writePcapPacket
+static std::vector<uint8_t> synthCapture(uint32_t records, std::vector<size_t>* ends) {
+    std::vector<uint8_t> v;
+    put32(v, PCAP_MAGIC);
+    put16(v, 2);
+    put16(v, 4);
+    put32(v, 0);
+    put32(v, 0);
+    put32(v, 65535);
+    put32(v, 105);
+    ends->push_back(v.size());
+
+    uint64_t us = 0;
+    for (uint32_t i = 0; i < records; i++) {
+        uint32_t len = 1 + rand() % 2559;
+        us += rand() % 5000;
+        put32(v, us / 1000000);
+        put32(v, us % 1000000);
+        put32(v, len);
+        put32(v, len);
+        for (uint32_t j = 0; j < len; j++) v.push_back(rand());
+        ends->push_back(v.size());
+    }
+    return v;
+}
+
+static int simulate(uint32_t runs, unsigned seed) {
+    srand(seed);
+    std::vector<size_t> ends;
+    std::vector<uint8_t> capture = synthCapture(2000, &ends);
+    std::vector<uint8_t> chunk(SCAN_CHUNK);
+    uint32_t failed = 0;
+
+    for (uint32_t i = 0; i < runs; i++) {
+        size_t cut = rand() % (capture.size() + 1);
+        std::vector<uint8_t> torn(capture.begin(), capture.begin() + cut);
+        bool zeroTail = i & 1;
+        if (zeroTail) torn.resize(cut + rand() % 8192, 0);
+
+        // Records that ended at or before the cut survive
+        size_t expect = 0;
+        uint32_t expectRecords = 0;
+        for (size_t k = 0; k < ends.size() && ends[k] <= cut; k++) {
+            expect = ends[k];
+            expectRecords = k;
+        }
+
+        MemReader read = { &torn };
+        PcapScan scan = pcapScan(read, torn.size(), chunk.data(), chunk.size());
+
+        torn.resize(scan.valid);
+        PcapScan rescan = pcapScan(read, torn.size(), chunk.data(), chunk.size());
+
+        bool straddler = zeroTail && expectRecords + 1 < ends.size() &&
+                         scan.valid == ends[expectRecords + 1] && scan.records == expectRecords + 1;
+        bool exact = scan.valid == expect && scan.records == expectRecords;
+        if (!(exact || straddler) || rescan.valid != scan.valid) {
+            failed++;
+            printf("FAIL cut %zu%s: kept %zu bytes / %u records, expected %zu / %u\n",
+                   cut, zeroTail ? " +zeros" : "", scan.valid, scan.records, expect, expectRecords);
+        }
+    }
+
+    printf("%u truncations (seed %u, %zu byte capture): %u failed\n",
+           runs, seed, capture.size(), failed);
+    return failed ? 1 : 0;
+}
+
+static int repair(const char* path, bool dryRun) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t size = ftell(f);
+
+    std::vector<uint8_t> chunk(SCAN_CHUNK);
+    FileReader read = { f };
+    PcapScan scan = pcapScan(read, size, chunk.data(), chunk.size());
+    fclose(f);
+
+    if (scan.valid == 0) {
+        printf("%s: no intact pcap header\n", path);
+        return 1;
+    }
+    if (scan.valid == size) {
+        printf("%s: OK, %u records\n", path, scan.records);
+        return 0;
+    }
+    printf("%s: %u records, %zu torn bytes at %zu%s\n", path, scan.records,
+           size - scan.valid, scan.valid, dryRun ? "" : " - cut");
+    if (!dryRun && truncate(path, scan.valid) != 0) {
+        perror(path);
+        return 1;
+    }
+    return dryRun ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "--simulate") == 0) {
+        unsigned seed = argc > 3 ? strtoul(argv[3], nullptr, 10) : 1;
+        return simulate(strtoul(argv[2], nullptr, 10), seed);
+    }
+
+    bool dryRun = argc > 1 && strcmp(argv[1], "--check") == 0;
+    int first = dryRun ? 2 : 1;
+    if (argc <= first) {
+        fprintf(stderr, "usage: %s [--check] capture.pcap [...] | --simulate N [seed]\n", argv[0]);
+        return 2;
+    }
+    int failed = 0;
+    for (int i = first; i < argc; i++) failed += repair(argv[i], dryRun);
+    return failed ? 1 : 0;
+}
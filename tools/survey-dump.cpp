@@ -0,0 +1,128 @@
+// Lists channel survey records written by the sniffer's survey mode.
+//
+//   survey-dump /mnt/sdcard/survey/<stamp>.srv             CSV to stdout
+//   survey-dump --summary /mnt/sdcard/survey/*.srv         per-channel totals
+//
+// CSV columns: time (UTC, or +seconds since boot when the clock was unset),
+// channel, interval_s, listen_ms, util_pct (airtime / listen time), frames,
+// mgmt / ctrl / data, beacons, retry_pct, transmitters (+ when the table
+// saturated), rssi_mean, noise_floor, then the RSSI histogram
+// (<-90, -90..-81, ..., >=-30 dBm). Torn or corrupt records are skipped and
+// counted on stderr.
+//
+// Build: g++ -O2 -std=c++11 -Iinclude tools/survey-dump.cpp -o survey-dump
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "survey.h"
+
+struct ChannelTotal {
+    uint64_t listenMs;
+    uint64_t airtimeUs;
+    uint64_t frames;
+    uint64_t retries;
+    uint32_t records;
+    uint32_t maxTransmitters;
+    double peakUtil;
+};
+
+static double utilPct(uint64_t airtimeUs, uint64_t listenMs) {
+    return listenMs ? airtimeUs / 10.0 / listenMs : 0;
+}
+
+static void printRecord(const SurveyRecord& r) {
+    char when[32];
+    if (r.flags & SURVEY_CLOCK_SET) {
+        time_t t = r.time;
+        strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+    } else {
+        snprintf(when, sizeof(when), "+%u", r.uptimeS);
+    }
+    printf("%s,%u,%u,%u,%.1f,%u,%u,%u,%u,%u,%.1f,%u%s,%d,%d", when, r.channel, r.intervalS,
+           r.listenMs, utilPct(r.airtimeUs, r.listenMs), r.frames, r.mgmt, r.ctrl, r.data, r.beacons,
+           r.frames ? r.retries * 100.0 / r.frames : 0, r.transmitters,
+           r.flags & SURVEY_TX_SATURATED ? "+" : "", r.rssiMean, r.noiseFloor);
+    for (int i = 0; i < SURVEY_RSSI_BUCKETS; i++) printf(",%u", r.rssi[i]);
+    printf("\n");
+}
+
+static bool readSurvey(const char* path, bool summary, ChannelTotal* totals) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    SurveyHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || !surveyHeaderValid(&header)) {
+        fprintf(stderr, "%s: not a survey file\n", path);
+        fclose(f);
+        return false;
+    }
+
+    SurveyRecord r;
+    uint32_t good = 0, bad = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1) {
+        if (!surveyValid(&r)) {
+            bad++;
+            continue;
+        }
+        good++;
+        if (!summary) {
+            printRecord(r);
+            continue;
+        }
+        ChannelTotal& t = totals[r.channel];
+        t.listenMs += r.listenMs;
+        t.airtimeUs += r.airtimeUs;
+        t.frames += r.frames;
+        t.retries += r.retries;
+        t.records++;
+        if (r.transmitters > t.maxTransmitters) t.maxTransmitters = r.transmitters;
+        double util = utilPct(r.airtimeUs, r.listenMs);
+        if (util > t.peakUtil) t.peakUtil = util;
+    }
+    fclose(f);
+    fprintf(stderr, "%s: %u records\n", path, good);
+    if (bad) fprintf(stderr, "%s: %u torn or corrupt records skipped\n", path, bad);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool summary = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--summary") == 0) {
+        summary = true;
+        first = 2;
+    }
+    if (argc <= first) {
+        fprintf(stderr, "usage: %s [--summary] survey.srv [...]\n", argv[0]);
+        return 2;
+    }
+
+    ChannelTotal totals[SURVEY_CHANNELS] = {};
+    if (!summary) {
+        printf("time,channel,interval_s,listen_ms,util_pct,frames,mgmt,ctrl,data,beacons,retry_pct,"
+               "transmitters,rssi_mean,noise_floor");
+        printf(",rssi_lt-90");
+        for (int i = 1; i < SURVEY_RSSI_BUCKETS; i++) printf(",rssi_%d", -100 + 10 * i);
+        printf("\n");
+    }
+    int failed = 0;
+    for (int i = first; i < argc; i++) failed += !readSurvey(argv[i], summary, totals);
+
+    if (summary) {
+        printf("%3s %8s %10s %8s %8s %12s %8s %6s\n", "CH", "records", "listen_s", "util%", "peak%",
+               "frames", "retry%", "tx max");
+        for (int ch = 1; ch < SURVEY_CHANNELS; ch++) {
+            const ChannelTotal& t = totals[ch];
+            if (!t.records) continue;
+            printf("%3d %8u %10.0f %8.1f %8.1f %12llu %8.1f %6u\n", ch, t.records, t.listenMs / 1000.0,
+                   utilPct(t.airtimeUs, t.listenMs), t.peakUtil, (unsigned long long)t.frames,
+                   t.frames ? t.retries * 100.0 / t.frames : 0, t.maxTransmitters);
+        }
+    }
+    return failed ? 1 : 0;
+}